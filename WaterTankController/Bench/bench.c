@@ -0,0 +1,416 @@
+/***********************************************************************
+ *
+ * Cycle-accurate benchmark of the firmware under simavr.
+ * Linux, GCC, simavr, libelf
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/* Includes ----------------------------------------------------------*/
+#include <fcntl.h>
+#include <gelf.h>
+#include <libelf.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_irq.h>
+#include <simavr/sim_cycle_timers.h>
+#include <simavr/sim_interrupts.h>
+#include <simavr/avr_ioport.h>
+
+/* Defines -----------------------------------------------------------*/
+#define F_CPU          16000000UL
+#define TRIG_PIN       0     // PD0
+#define ECHO_PIN       2     // PD2
+#define ECHO_DELAY_US  250   // Burst of 8 periods at 40 kHz and margin
+#define SOUND_MM_PER_S 343000
+#define MAX_ACTIVE     8     // Nesting depth of measured functions
+
+/* Types -------------------------------------------------------------*/
+typedef struct {
+    uint64_t count;
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+} stat_t;
+
+// Function measured from entry to return
+typedef struct {
+    const char *name;
+    uint8_t task;         // Counts into CPU load
+    uint32_t addr;        // Byte address, 0 if not found in ELF
+    stat_t cycles;
+} function_t;
+
+// Interrupt measured from vector entry to RETI
+typedef struct {
+    const char *name;
+    uint8_t vector;
+    avr_cycle_count_t raised;
+    avr_cycle_count_t entered;
+    stat_t cycles;
+    stat_t latency;
+} interrupt_t;
+
+typedef struct {
+    function_t *function;
+    uint16_t sp;
+    avr_cycle_count_t start;
+    uint64_t isr_start;   // ISR cycles spent before entry
+} active_t;
+
+/* Variables ---------------------------------------------------------*/
+static function_t functions[] = {
+    {"measure_task",           1, 0, {0}},
+    {"control_task",           1, 0, {0}},
+    {"display_task",           1, 0, {0}},
+    {"telemetry_task",         1, 0, {0}},
+    {"calculate_water_volume", 0, 0, {0}},
+    {"lcd_buffer_flush",       0, 0, {0}},
+    {"lcd_buffer_show",        0, 0, {0}},
+};
+#define FUNCTIONS (sizeof(functions) / sizeof(functions[0]))
+
+// ATmega328P vector numbers
+static interrupt_t interrupts[] = {
+    {"PCINT2_vect",       5,  0, 0, {0}, {0}},
+    {"TIMER2_COMPA_vect", 7,  0, 0, {0}, {0}},
+    {"TIMER1_COMPA_vect", 11, 0, 0, {0}, {0}},
+    {"TIMER1_COMPB_vect", 12, 0, 0, {0}, {0}},
+    {"TIMER0_COMPA_vect", 14, 0, 0, {0}, {0}},
+    {"USART_UDRE_vect",   19, 0, 0, {0}, {0}},
+    {"EE_READY_vect",     22, 0, 0, {0}, {0}},
+};
+#define INTERRUPTS (sizeof(interrupts) / sizeof(interrupts[0]))
+
+static avr_t *avr;
+static avr_irq_t *echo_irq;
+static active_t active[MAX_ACTIVE];
+static uint8_t active_count;
+static uint64_t isr_cycles;
+static uint64_t task_cycles;
+
+// Synthetic waveform
+static uint32_t min_mm = 200;
+static uint32_t max_mm = 4000;
+static uint32_t sweep_pings = 200;
+static uint32_t spike_every = 0;
+static uint32_t pings;
+
+/* Function definitions ----------------------------------------------*/
+static void stat_add(stat_t *s, uint64_t value)
+{
+    if (!s->count || value < s->min)
+        s->min = value;
+    if (value > s->max)
+        s->max = value;
+    s->total += value;
+    ++s->count;
+}
+
+static void stat_json(FILE *out, const char *key, const stat_t *s)
+{
+    fprintf(out, "\"%s\": {\"count\": %llu, \"min\": %llu, \"max\": %llu, \"avg\": %.1f}",
+            key, (unsigned long long)s->count,
+            (unsigned long long)s->min, (unsigned long long)s->max,
+            s->count ? (double)s->total / s->count : 0.0);
+}
+
+/**********************************************************************
+ * Function: find_symbols()
+ * Purpose:  Look up addresses of measured functions in the ELF file.
+ **********************************************************************/
+static int find_symbols(const char *path)
+{
+    Elf *elf;
+    Elf_Scn *scn = NULL;
+    int fd;
+
+    if (elf_version(EV_CURRENT) == EV_NONE)
+        return -1;
+    if ((fd = open(path, O_RDONLY)) < 0)
+        return -1;
+    if (!(elf = elf_begin(fd, ELF_C_READ, NULL))) {
+        close(fd);
+        return -1;
+    }
+
+    while ((scn = elf_nextscn(elf, scn)) != NULL) {
+        GElf_Shdr shdr;
+        Elf_Data *data;
+
+        if (!gelf_getshdr(scn, &shdr) || shdr.sh_type != SHT_SYMTAB)
+            continue;
+
+        data = elf_getdata(scn, NULL);
+        for (size_t i = 0; i < shdr.sh_size / shdr.sh_entsize; i++) {
+            GElf_Sym sym;
+            const char *name;
+
+            if (!gelf_getsym(data, i, &sym) || GELF_ST_TYPE(sym.st_info) != STT_FUNC)
+                continue;
+
+            name = elf_strptr(elf, shdr.sh_link, sym.st_name);
+            for (size_t f = 0; name && f < FUNCTIONS; f++) {
+                if (!strcmp(name, functions[f].name))
+                    functions[f].addr = sym.st_value;
+            }
+        }
+    }
+
+    elf_end(elf);
+    close(fd);
+    return 0;
+}
+
+/**********************************************************************
+ * Function: echo distance waveform
+ * Purpose:  Triangle sweep between min and max distance with optional
+ *           spurious short echo every n-th ping.
+ **********************************************************************/
+static uint32_t next_distance_mm(void)
+{
+    uint32_t phase = pings % (2 * sweep_pings);
+    uint32_t span = max_mm - min_mm;
+
+    ++pings;
+    if (spike_every && pings % spike_every == 0)
+        return min_mm / 2;
+    if (phase >= sweep_pings)
+        phase = 2 * sweep_pings - phase;
+
+    return min_mm + (uint64_t)span * phase / sweep_pings;
+}
+
+static avr_cycle_count_t echo_fall(avr_t *avr, avr_cycle_count_t when, void *param)
+{
+    (void)avr; (void)when; (void)param;
+    avr_raise_irq(echo_irq, 0);
+    return 0;
+}
+
+static avr_cycle_count_t echo_rise(avr_t *avr, avr_cycle_count_t when, void *param)
+{
+    uint32_t echo_us = (uintptr_t)param;
+
+    (void)when;
+    avr_raise_irq(echo_irq, 1);
+    avr_cycle_timer_register_usec(avr, echo_us, echo_fall, NULL);
+    return 0;
+}
+
+/**********************************************************************
+ * Function: trig_changed()
+ * Purpose:  HC-SR04 answers falling edge of trigger with echo pulse.
+ **********************************************************************/
+static void trig_changed(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+    uint32_t echo_us;
+
+    (void)param;
+    if (value || !irq->value)
+        return;
+
+    echo_us = (uint64_t)2 * next_distance_mm() * 1000000 / SOUND_MM_PER_S;
+    avr_cycle_timer_register_usec(avr, ECHO_DELAY_US, echo_rise, (void *)(uintptr_t)echo_us);
+}
+
+static void vector_pending(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+    interrupt_t *v = param;
+
+    (void)irq;
+    if (value)
+        v->raised = avr->cycle;
+}
+
+static void vector_running(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+    interrupt_t *v = param;
+
+    (void)irq;
+    if (value) {
+        v->entered = avr->cycle;
+        stat_add(&v->latency, v->entered - v->raised);
+    }
+    else {
+        stat_add(&v->cycles, avr->cycle - v->entered);
+        isr_cycles += avr->cycle - v->entered;
+    }
+}
+
+static uint16_t stack_pointer(void)
+{
+    return avr->data[R_SPL] | (avr->data[R_SPH] << 8);
+}
+
+/**********************************************************************
+ * Function: track_functions()
+ * Purpose:  Called after every instruction, detects entry of measured
+ *           functions and their return by stack pointer going above
+ *           the value it had at entry. Cycles include interrupts which
+ *           preempted the function.
+ **********************************************************************/
+static void track_functions(void)
+{
+    uint16_t sp = stack_pointer();
+
+    while (active_count && sp > active[active_count - 1].sp) {
+        active_t *a = &active[--active_count];
+        uint64_t cycles = avr->cycle - a->start;
+
+        stat_add(&a->function->cycles, cycles);
+        if (a->function->task)
+            task_cycles += cycles - (isr_cycles - a->isr_start);
+    }
+
+    for (size_t f = 0; f < FUNCTIONS; f++) {
+        if (functions[f].addr && avr->pc == functions[f].addr && active_count < MAX_ACTIVE) {
+            active[active_count].function = &functions[f];
+            active[active_count].sp = sp;
+            active[active_count].start = avr->cycle;
+            active[active_count].isr_start = isr_cycles;
+            ++active_count;
+        }
+    }
+}
+
+static void write_json(FILE *out, const char *firmware, uint64_t cycles)
+{
+    uint64_t latency_max = 0;
+
+    fprintf(out, "{\n  \"firmware\": \"%s\",\n  \"f_cpu\": %lu,\n", firmware, F_CPU);
+    fprintf(out, "  \"cycles\": %llu,\n  \"pings\": %u,\n",
+            (unsigned long long)cycles, (unsigned)pings);
+
+    fprintf(out, "  \"functions\": {\n");
+    for (size_t f = 0; f < FUNCTIONS; f++) {
+        fprintf(out, "    ");
+        stat_json(out, functions[f].name, &functions[f].cycles);
+        fprintf(out, "%s\n", f + 1 < FUNCTIONS ? "," : "");
+    }
+
+    fprintf(out, "  },\n  \"interrupts\": {\n");
+    for (size_t i = 0; i < INTERRUPTS; i++) {
+        fprintf(out, "    \"%s\": {", interrupts[i].name);
+        stat_json(out, "cycles", &interrupts[i].cycles);
+        fprintf(out, ", ");
+        stat_json(out, "latency", &interrupts[i].latency);
+        fprintf(out, "}%s\n", i + 1 < INTERRUPTS ? "," : "");
+        if (interrupts[i].latency.max > latency_max)
+            latency_max = interrupts[i].latency.max;
+    }
+
+    fprintf(out, "  },\n  \"latency_max_cycles\": %llu,\n", (unsigned long long)latency_max);
+    fprintf(out, "  \"isr_load_percent\": %.3f,\n", cycles ? 100.0 * isr_cycles / cycles : 0.0);
+    fprintf(out, "  \"cpu_load_percent\": %.3f\n}\n",
+            cycles ? 100.0 * (isr_cycles + task_cycles) / cycles : 0.0);
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "Usage: %s [options] firmware.elf\n"
+            "  -t SEC  simulated time (default 10)\n"
+            "  -m MM   nearest echo distance (default 200)\n"
+            "  -M MM   farthest echo distance (default 4000)\n"
+            "  -s N    pings per sweep from near to far (default 200)\n"
+            "  -x N    spurious short echo every N-th ping (default off)\n"
+            "  -o FILE write JSON to file instead of stdout\n",
+            name);
+}
+
+/**********************************************************************
+ * Function: main()
+ * Purpose:  Load firmware, attach echo generator and probes, run for
+ *           the requested time and report results as JSON.
+ **********************************************************************/
+int main(int argc, char *argv[])
+{
+    elf_firmware_t firmware;
+    const char *output = NULL;
+    double seconds = 10;
+    avr_cycle_count_t end;
+    FILE *out = stdout;
+    int opt, state;
+
+    while ((opt = getopt(argc, argv, "t:m:M:s:x:o:h")) != -1) {
+        switch (opt) {
+        case 't': seconds = atof(optarg); break;
+        case 'm': min_mm = atoi(optarg); break;
+        case 'M': max_mm = atoi(optarg); break;
+        case 's': sweep_pings = atoi(optarg); break;
+        case 'x': spike_every = atoi(optarg); break;
+        case 'o': output = optarg; break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (optind != argc - 1 || seconds <= 0 || max_mm < min_mm || !sweep_pings) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    memset(&firmware, 0, sizeof(firmware));
+    if (elf_read_firmware(argv[optind], &firmware) || find_symbols(argv[optind])) {
+        fprintf(stderr, "%s: cannot load %s\n", argv[0], argv[optind]);
+        return 1;
+    }
+    for (size_t f = 0; f < FUNCTIONS; f++) {
+        if (!functions[f].addr)
+            fprintf(stderr, "%s: %s not found, inlined?\n", argv[0], functions[f].name);
+    }
+
+    avr = avr_make_mcu_by_name("atmega328p");
+    if (!avr) {
+        fprintf(stderr, "%s: simavr lacks atmega328p\n", argv[0]);
+        return 1;
+    }
+    avr_init(avr);
+    avr->frequency = F_CPU;
+    avr_load_firmware(avr, &firmware);
+
+    echo_irq = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('D'), ECHO_PIN);
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('D'), TRIG_PIN),
+                            trig_changed, NULL);
+
+    for (size_t i = 0; i < INTERRUPTS; i++) {
+        avr_irq_t *irq = avr_get_interrupt_irq(avr, interrupts[i].vector);
+
+        if (!irq)
+            continue;
+        avr_irq_register_notify(irq + AVR_INT_IRQ_PENDING, vector_pending, &interrupts[i]);
+        avr_irq_register_notify(irq + AVR_INT_IRQ_RUNNING, vector_running, &interrupts[i]);
+    }
+
+    end = (avr_cycle_count_t)(seconds * F_CPU);
+    do {
+        state = avr_run(avr);
+        track_functions();
+    } while (avr->cycle < end && state != cpu_Done && state != cpu_Crashed);
+
+    if (state == cpu_Crashed) {
+        fprintf(stderr, "%s: firmware crashed at pc 0x%04x\n", argv[0], avr->pc);
+        return 1;
+    }
+
+    if (output && !(out = fopen(output, "w"))) {
+        perror(output);
+        return 1;
+    }
+    write_json(out, argv[optind], avr->cycle);
+    if (out != stdout)
+        fclose(out);
+
+    return 0;
+}
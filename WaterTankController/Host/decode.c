@@ -0,0 +1,264 @@
+/***********************************************************************
+ *
+ * Decoder of the water tank controller telemetry stream and event log.
+ * Linux, GCC
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/* Includes ----------------------------------------------------------*/
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <util/crc16.h>
+#include "eventlog.h"
+#include "telemetry.h"
+
+/* Variables ---------------------------------------------------------*/
+static uint8_t frame[TELEMETRY_FRAME];
+static uint8_t fill;
+static unsigned long frames, crc_errors, lost;
+static int last_sequence = -1;
+
+/* Function definitions ----------------------------------------------*/
+static void usage(const char *name)
+{
+    fprintf(stderr,
+        "usage: %s [-b baud] [source]\n"
+        "       %s -e eeprom.bin\n"
+        "  source  serial port, capture file or - for stdin (default -)\n"
+        "  -b      baud rate of a serial port (default %lu)\n"
+        "  -e      print event log of an EEPROM image instead, oldest first\n"
+        "Prints one CSV line per frame, statistics go to stderr.\n",
+        name, name, (unsigned long)TELEMETRY_BAUD);
+    exit(2);
+}
+
+static speed_t baud_constant(unsigned long baud)
+{
+    static const struct { unsigned long baud; speed_t constant; } rates[] = {
+        {9600, B9600}, {19200, B19200}, {38400, B38400},
+        {57600, B57600}, {115200, B115200}, {230400, B230400},
+        {500000, B500000}, {1000000, B1000000}, {2000000, B2000000},
+    };
+
+    for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+        if (rates[i].baud == baud)
+            return rates[i].constant;
+    }
+
+    fprintf(stderr, "unsupported baud rate %lu\n", baud);
+    exit(2);
+}
+
+/**********************************************************************
+ * Function: open_port()
+ * Purpose:  Put serial port to raw 8N1 mode, leave files untouched.
+ **********************************************************************/
+static void open_port(int fd, unsigned long baud)
+{
+    struct termios tio;
+
+    if (!isatty(fd))
+        return;
+
+    if (tcgetattr(fd, &tio) < 0) {
+        perror("tcgetattr");
+        exit(1);
+    }
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~(CSTOPB | PARENB | CRTSCTS);
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+    cfsetispeed(&tio, baud_constant(baud));
+    cfsetospeed(&tio, baud_constant(baud));
+    if (tcsetattr(fd, TCSANOW, &tio) < 0) {
+        perror("tcsetattr");
+        exit(1);
+    }
+    tcflush(fd, TCIFLUSH);
+}
+
+static uint16_t le16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+/**********************************************************************
+ * Function: print_frame()
+ * Purpose:  Print fields of a checked frame as one CSV line.
+ **********************************************************************/
+static void print_frame(const uint8_t *f)
+{
+    uint8_t sequence = f[2];
+
+    if (last_sequence >= 0)
+        lost += (uint8_t)(sequence - last_sequence - 1);
+    last_sequence = sequence;
+    ++frames;
+
+    printf("%u,%u,%u,%u,%u,%u,%u,%u,%u,%d,%u,%u,%u\n",
+        sequence, le16(&f[3]), le16(&f[5]), le16(&f[7]), le16(&f[9]),
+        f[11], !!(f[12] & TELEMETRY_PUMP_ON), !!(f[12] & TELEMETRY_VALVE_OPEN),
+        f[12] >> TELEMETRY_FAULT_SHIFT, (int8_t)f[13], le16(&f[14]), f[16], f[17]);
+}
+
+/**********************************************************************
+ * Function: feed()
+ * Purpose:  Collect bytes into frames, hunt for the next sync byte
+ *           after any broken frame.
+ **********************************************************************/
+static void feed(uint8_t byte)
+{
+    frame[fill++] = byte;
+
+    while (fill) {
+        uint8_t crc = 0;
+        uint8_t i;
+
+        if (frame[0] != TELEMETRY_SYNC || (fill > 1 && frame[1] != TELEMETRY_PAYLOAD)) {
+            // Not a frame start, drop first byte and look again
+        }
+        else if (fill < TELEMETRY_FRAME) {
+            return;
+        }
+        else {
+            for (i = 1; i < TELEMETRY_FRAME - 1; i++)
+                crc = _crc8_ccitt_update(crc, frame[i]);
+            if (crc == frame[TELEMETRY_FRAME - 1]) {
+                print_frame(frame);
+                fill = 0;
+                return;
+            }
+            ++crc_errors;
+        }
+
+        for (i = 1; i < fill && frame[i] != TELEMETRY_SYNC; i++)
+            ;
+        memmove(frame, &frame[i], fill - i);
+        fill -= i;
+    }
+}
+
+/**********************************************************************
+ * Function: print_eventlog()
+ * Purpose:  Decode event log slots of an EEPROM image, same checks
+ *           as eventlog_init() in the firmware.
+ **********************************************************************/
+static int print_eventlog(const char *path)
+{
+    static const char *names[] = {
+        [EVENTLOG_BOOT] = "boot",
+        [EVENTLOG_PUMP_ON] = "pump_on",
+        [EVENTLOG_PUMP_OFF] = "pump_off",
+        [EVENTLOG_VALVE_OPEN] = "valve_open",
+        [EVENTLOG_VALVE_CLOSE] = "valve_close",
+        [EVENTLOG_OVERFLOW] = "overflow",
+        [EVENTLOG_LEVEL] = "level",
+        [EVENTLOG_NO_ECHO] = "no_echo",
+        [EVENTLOG_STUCK] = "stuck",
+        [EVENTLOG_DRY_RUN] = "dry_run",
+        [EVENTLOG_WATCHDOG] = "watchdog",
+    };
+    uint8_t image[EVENTLOG_EEPROM_END];
+    uint8_t valid[EVENTLOG_SLOTS] = {0};
+    uint16_t newest = 0;
+    int slot, count = 0, newest_slot = -1;
+    FILE *f = fopen(path, "rb");
+
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+    if (fread(image, 1, sizeof(image), f) != sizeof(image)) {
+        fprintf(stderr, "%s: not a %d byte EEPROM image\n", path, EVENTLOG_EEPROM_END);
+        fclose(f);
+        return 1;
+    }
+    fclose(f);
+
+    for (slot = 0; slot < EVENTLOG_SLOTS; slot++) {
+        const uint8_t *r = &image[EVENTLOG_EEPROM_ADDR + slot * EVENTLOG_RECORD];
+        uint8_t crc = 0;
+
+        for (int i = 0; i < EVENTLOG_RECORD - 1; i++)
+            crc = _crc8_ccitt_update(crc, r[i]);
+        if (crc != r[EVENTLOG_RECORD - 1] || r[6] == 0xFF)
+            continue;
+
+        valid[slot] = 1;
+        if (newest_slot < 0 || (int16_t)(le16(r) - newest) > 0) {
+            newest = le16(r);
+            newest_slot = slot;
+        }
+    }
+
+    printf("seq,time_s,event,distance_cm\n");
+    // Oldest record follows the newest one in the ring
+    for (int n = 1; newest_slot >= 0 && n <= EVENTLOG_SLOTS; n++) {
+        const uint8_t *r;
+
+        slot = (newest_slot + n) % EVENTLOG_SLOTS;
+        if (!valid[slot])
+            continue;
+        r = &image[EVENTLOG_EEPROM_ADDR + slot * EVENTLOG_RECORD];
+        printf("%u,%u,%s,%u\n", le16(r),
+            r[2] | (r[3] << 8) | (r[4] << 16) | ((unsigned)r[5] << 24),
+            r[6] < sizeof(names) / sizeof(names[0]) && names[r[6]] ? names[r[6]] : "unknown",
+            le16(&r[7]));
+        ++count;
+    }
+    fprintf(stderr, "%d records\n", count);
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long baud = TELEMETRY_BAUD;
+    uint8_t data[256];
+    ssize_t n;
+    int fd = STDIN_FILENO;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "b:e:h")) != -1) {
+        switch (opt) {
+        case 'b': baud = strtoul(optarg, NULL, 0); break;
+        case 'e': return print_eventlog(optarg);
+        default:  usage(argv[0]);
+        }
+    }
+    if (optind + 1 < argc)
+        usage(argv[0]);
+
+    if (optind < argc && strcmp(argv[optind], "-") != 0) {
+        fd = open(argv[optind], O_RDONLY | O_NOCTTY);
+        if (fd < 0) {
+            perror(argv[optind]);
+            return 1;
+        }
+    }
+    open_port(fd, baud);
+
+    // Line buffered so a log follows the board in real time
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    printf("seq,echo_ticks,raw_cm,distance_cm,litres,percent,pump,valve,"
+           "faults,temperature_c,isr_latency_max,queue_overruns,dropped\n");
+
+    while ((n = read(fd, data, sizeof(data))) > 0) {
+        for (ssize_t i = 0; i < n; i++)
+            feed(data[i]);
+    }
+
+    fprintf(stderr, "%lu frames, %lu CRC errors, %lu lost\n", frames, crc_errors, lost);
+
+    return 0;
+}
@@ -0,0 +1,892 @@
+/***********************************************************************
+ *
+ * Simulated ATmega328P core for host build of the firmware.
+ * Linux, GCC
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/* Includes ----------------------------------------------------------*/
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <avr/eeprom.h>
+#include <avr/interrupt.h>
+#include <util/delay.h>
+#include "hal.h"
+
+/* Defines -----------------------------------------------------------*/
+#define PIN_ADDR(port)  (0x23 + 3 * (port))
+#define PINX(port)      hal_io[PIN_ADDR(port)]
+#define DDRX(port)      hal_io[PIN_ADDR(port) + 1]
+#define PORTX(port)     hal_io[PIN_ADDR(port) + 2]
+#define NEVER           UINT64_MAX
+
+// CPU time of an interrupt, firmware code itself takes no time, so
+// without it no interrupt could ever be late
+#define ISR_ENTRY_CYCLES 20  // Response, vector jump and prologue
+#define ISR_BODY_CYCLES  200 // Body and epilogue of a short handler
+
+// Interrupt flags of a timer, same bit positions on all timers
+#define TIMER_TOV       (1<<0)
+#define TIMER_OCFA      (1<<1)
+#define TIMER_OCFB      (1<<2)
+
+/* Types -------------------------------------------------------------*/
+// Interrupt vectors in order of priority
+typedef enum {
+    V_INT0, V_INT1, V_PCINT0, V_PCINT1, V_PCINT2, V_WDT,
+    V_TIMER2_COMPA, V_TIMER2_COMPB, V_TIMER2_OVF,
+    V_TIMER1_COMPA, V_TIMER1_COMPB, V_TIMER1_OVF,
+    V_TIMER0_COMPA, V_TIMER0_COMPB, V_TIMER0_OVF,
+    V_USART_UDRE, V_USART_TX, V_ADC, V_EE_READY,
+    V_COUNT
+} vector_id_t;
+
+typedef struct {
+    void (*isr)(void);  // Firmware handler, NULL if not defined
+    uint8_t mask_reg;   // Interrupt mask register address
+    uint8_t mask_bit;   // Enable bit in mask register
+} vector_t;
+
+typedef struct {
+    uint8_t tccra, tccrb, tcnt, ocra, ocrb, timsk; // Register addresses
+    uint8_t wide;                 // 16-bit counter
+    const uint16_t *prescalers;   // Prescaler indexed by CS bits
+    vector_id_t vector_a;         // Compare match A vector
+    uint64_t phase;               // Cycles since last counter tick
+} sim_timer_t;
+
+typedef struct {
+    uint64_t at;
+    hal_event_t event;
+    void *context;
+} scheduled_t;
+
+/* Firmware interrupt handlers, weak so undefined ones read as NULL --*/
+#define HAL_VECTOR(name) extern void name(void) __attribute__((weak));
+HAL_VECTOR(INT0_vect)
+HAL_VECTOR(INT1_vect)
+HAL_VECTOR(PCINT0_vect)
+HAL_VECTOR(PCINT1_vect)
+HAL_VECTOR(PCINT2_vect)
+HAL_VECTOR(WDT_vect)
+HAL_VECTOR(TIMER2_COMPA_vect)
+HAL_VECTOR(TIMER2_COMPB_vect)
+HAL_VECTOR(TIMER2_OVF_vect)
+HAL_VECTOR(TIMER1_COMPA_vect)
+HAL_VECTOR(TIMER1_COMPB_vect)
+HAL_VECTOR(TIMER1_OVF_vect)
+HAL_VECTOR(TIMER0_COMPA_vect)
+HAL_VECTOR(TIMER0_COMPB_vect)
+HAL_VECTOR(TIMER0_OVF_vect)
+HAL_VECTOR(USART_UDRE_vect)
+HAL_VECTOR(USART_TX_vect)
+HAL_VECTOR(ADC_vect)
+HAL_VECTOR(EE_READY_vect)
+
+/* Variables ---------------------------------------------------------*/
+volatile uint8_t hal_io[0x100];
+
+static const vector_t vectors[V_COUNT] = {
+    [V_INT0]         = {INT0_vect,         0x3D, INT0},
+    [V_INT1]         = {INT1_vect,         0x3D, INT1},
+    [V_PCINT0]       = {PCINT0_vect,       0x68, PCIE0},
+    [V_PCINT1]       = {PCINT1_vect,       0x68, PCIE1},
+    [V_PCINT2]       = {PCINT2_vect,       0x68, PCIE2},
+    [V_WDT]          = {WDT_vect,          0x60, WDIE},
+    [V_TIMER2_COMPA] = {TIMER2_COMPA_vect, 0x70, OCIE2A},
+    [V_TIMER2_COMPB] = {TIMER2_COMPB_vect, 0x70, OCIE2B},
+    [V_TIMER2_OVF]   = {TIMER2_OVF_vect,   0x70, TOIE2},
+    [V_TIMER1_COMPA] = {TIMER1_COMPA_vect, 0x6F, OCIE1A},
+    [V_TIMER1_COMPB] = {TIMER1_COMPB_vect, 0x6F, OCIE1B},
+    [V_TIMER1_OVF]   = {TIMER1_OVF_vect,   0x6F, TOIE1},
+    [V_TIMER0_COMPA] = {TIMER0_COMPA_vect, 0x6E, OCIE0A},
+    [V_TIMER0_COMPB] = {TIMER0_COMPB_vect, 0x6E, OCIE0B},
+    [V_TIMER0_OVF]   = {TIMER0_OVF_vect,   0x6E, TOIE0},
+    [V_USART_UDRE]   = {USART_UDRE_vect,   0xC1, UDRIE0},
+    [V_USART_TX]     = {USART_TX_vect,     0xC1, TXCIE0},
+    [V_ADC]          = {ADC_vect,          0x7A, ADIE},
+    [V_EE_READY]     = {EE_READY_vect,     0x3F, EERIE},
+};
+
+static const uint16_t prescalers_01[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+static const uint16_t prescalers_2[8]  = {0, 1, 8, 32, 64, 128, 256, 1024};
+
+static sim_timer_t timers[] = {
+    {0x44, 0x45, 0x46, 0x47, 0x48, 0x6E, 0, prescalers_01, V_TIMER0_COMPA, 0},
+    {0x80, 0x81, 0x84, 0x88, 0x8A, 0x6F, 1, prescalers_01, V_TIMER1_COMPA, 0},
+    {0xB0, 0xB1, 0xB2, 0xB3, 0xB4, 0x70, 0, prescalers_2,  V_TIMER2_COMPA, 0},
+};
+#define TIMERS (sizeof(timers) / sizeof(timers[0]))
+
+static uint64_t now;
+static uint64_t end;
+static jmp_buf exit_point;
+static uint32_t pending;
+static uint64_t isr_count;
+static uint8_t isr_depth;
+// Busy-wait delays in progress, an ISR may wait inside a waiting main
+static uint8_t delay_depth;
+
+static uint8_t ext_level[HAL_PORTS];
+static uint8_t last_output[HAL_PORTS];
+static uint8_t last_pin[HAL_PORTS];
+// PINx as last written by sync_pins(), output bits read as 0
+static uint8_t published_pin[HAL_PORTS];
+
+static uint16_t adc_inputs[HAL_ADC_CHANNELS];
+static uint64_t adc_done;
+
+static uint8_t eeprom[HAL_EEPROM_SIZE];
+static uint64_t eeprom_done;
+static uint16_t eeprom_address;
+static uint8_t eeprom_data;
+
+static uint8_t uart_written;
+static uint64_t uart_empty;
+
+static uint64_t wdt_kicked;
+
+static scheduled_t events[HAL_EVENTS];
+static uint8_t event_count;
+
+static hal_port_hook_t port_hooks[HAL_HOOKS];
+static uint8_t port_hook_count;
+static hal_delay_hook_t delay_hooks[HAL_HOOKS];
+static uint8_t delay_hook_count;
+static hal_uart_hook_t uart_hooks[HAL_HOOKS];
+static uint8_t uart_hook_count;
+
+/* Function definitions ----------------------------------------------*/
+/**********************************************************************
+ * Function: raise()
+ * Purpose:  Latch interrupt request if the interrupt is enabled.
+ **********************************************************************/
+static void raise(vector_id_t v)
+{
+    if (hal_io[vectors[v].mask_reg] & _BV(vectors[v].mask_bit))
+        pending |= (1UL<<v);
+}
+
+/**********************************************************************
+ * Function: timer helpers
+ * Purpose:  Counter access, prescaler and top value of a timer.
+ **********************************************************************/
+static uint32_t reg_read(uint8_t addr, uint8_t wide)
+{
+    return wide ? (uint32_t)(hal_io[addr] | (hal_io[addr + 1] << 8)) : hal_io[addr];
+}
+
+static void reg_write(uint8_t addr, uint8_t wide, uint32_t value)
+{
+    hal_io[addr] = value & 0xFF;
+    if (wide)
+        hal_io[addr + 1] = (value >> 8) & 0xFF;
+}
+
+static uint16_t timer_prescaler(const sim_timer_t *t)
+{
+    return t->prescalers[hal_io[t->tccrb] & 0x07];
+}
+
+static uint8_t timer_is_ctc(const sim_timer_t *t)
+{
+    if (t->wide)
+        return (hal_io[t->tccra] & 0x03) == 0 && (hal_io[t->tccrb] & 0x18) == 0x08;
+    return (hal_io[t->tccra] & 0x03) == 0x02 && !(hal_io[t->tccrb] & 0x08);
+}
+
+static uint32_t timer_period(const sim_timer_t *t)
+{
+    if (timer_is_ctc(t))
+        return reg_read(t->ocra, t->wide) + 1;
+    return t->wide ? 0x10000 : 0x100;
+}
+
+// Counter ticks until counter holds value, in the interval 1..period
+static uint32_t ticks_to(uint32_t from, uint32_t to, uint32_t period)
+{
+    uint32_t d = (to + period - from) % period;
+    return d ? d : period;
+}
+
+// Counter value at which compare match A sets its flag, in CTC mode
+// the flag is set together with clearing the counter after TOP
+static uint32_t compare_a(const sim_timer_t *t, uint32_t period)
+{
+    if (timer_is_ctc(t))
+        return 0;
+    return reg_read(t->ocra, t->wide) % period;
+}
+
+/**********************************************************************
+ * Function: timer_next_event()
+ * Purpose:  Cycles until the next enabled interrupt of a timer.
+ **********************************************************************/
+static uint64_t timer_next_event(const sim_timer_t *t)
+{
+    uint16_t prescaler = timer_prescaler(t);
+    uint8_t mask = hal_io[t->timsk];
+    uint32_t period, count, best = UINT32_MAX;
+
+    if (!prescaler || !(mask & (TIMER_TOV | TIMER_OCFA | TIMER_OCFB)))
+        return NEVER;
+
+    period = timer_period(t);
+    count = reg_read(t->tcnt, t->wide) % period;
+
+    if (mask & TIMER_OCFA)
+        best = ticks_to(count, compare_a(t, period), period);
+    if ((mask & TIMER_OCFB) && reg_read(t->ocrb, t->wide) < period) {
+        uint32_t d = ticks_to(count, reg_read(t->ocrb, t->wide), period);
+        if (d < best)
+            best = d;
+    }
+    if ((mask & TIMER_TOV) && !timer_is_ctc(t)) {
+        uint32_t d = ticks_to(count, 0, period);
+        if (d < best)
+            best = d;
+    }
+
+    if (best == UINT32_MAX)
+        return NEVER;
+    return (uint64_t)best * prescaler - t->phase;
+}
+
+/**********************************************************************
+ * Function: timer_step()
+ * Purpose:  Advance timer by a number of cycles and latch its events.
+ **********************************************************************/
+static void timer_step(sim_timer_t *t, uint64_t cycles)
+{
+    uint16_t prescaler = timer_prescaler(t);
+    uint32_t period, count;
+    uint64_t total, ticks;
+
+    if (!prescaler)
+        return;
+
+    total = t->phase + cycles;
+    ticks = total / prescaler;
+    t->phase = total % prescaler;
+    if (!ticks)
+        return;
+
+    period = timer_period(t);
+    count = reg_read(t->tcnt, t->wide) % period;
+
+    if (ticks_to(count, compare_a(t, period), period) <= ticks)
+        raise(t->vector_a);
+    if (reg_read(t->ocrb, t->wide) < period &&
+        ticks_to(count, reg_read(t->ocrb, t->wide), period) <= ticks)
+        raise(t->vector_a + 1);
+    if (!timer_is_ctc(t) && ticks_to(count, 0, period) <= ticks)
+        raise(t->vector_a + 2);
+
+    reg_write(t->tcnt, t->wide, (count + ticks) % period);
+}
+
+/**********************************************************************
+ * Function: adc_poll()
+ * Purpose:  Notice conversion started by the firmware and finish it
+ *           13 ADC clocks later.
+ **********************************************************************/
+static void adc_poll(void)
+{
+    static const uint8_t adc_prescalers[8] = {2, 2, 4, 8, 16, 32, 64, 128};
+    uint8_t running = (ADCSRA & _BV(ADEN)) && (ADCSRA & _BV(ADSC)) && !(PRR & _BV(PRADC));
+
+    if (!running) {
+        adc_done = NEVER;
+        return;
+    }
+
+    if (adc_done == NEVER) {
+        adc_done = now + 13 * adc_prescalers[ADCSRA & 0x07];
+    }
+    else if (adc_done <= now) {
+        ADC = adc_inputs[ADMUX & 0x0F] & 0x3FF;
+        ADCSRA = (ADCSRA & ~_BV(ADSC)) | _BV(ADIF);
+        raise(V_ADC);
+        adc_done = NEVER;
+    }
+}
+
+/**********************************************************************
+ * Function: uart_poll()
+ * Purpose:  Move byte written to UDR0 into the shift register and
+ *           raise data register empty interrupt while UDRE0 is set.
+ *           Data register is free again one frame time after a write,
+ *           transmission is modelled without the shift register delay.
+ **********************************************************************/
+static void uart_poll(void)
+{
+    uint8_t enabled = (UCSR0B & _BV(TXEN0)) && !(PRR & _BV(PRUSART0));
+
+    if (uart_written) {
+        uart_written = 0;
+        if (enabled) {
+            // Start, 8 data and stop bit, 16 or 8 cycles per bit sample
+            uint64_t bit = (uint64_t)(UBRR0 + 1) * ((UCSR0A & _BV(U2X0)) ? 8 : 16);
+
+            for (uint8_t i = 0; i < uart_hook_count; i++)
+                uart_hooks[i](hal_io[0xC6]);
+            UCSR0A &= ~_BV(UDRE0);
+            uart_empty = now + 10 * bit;
+        }
+    }
+
+    if (uart_empty <= now) {
+        uart_empty = NEVER;
+        UCSR0A |= _BV(TXC0);
+    }
+    // Status bit is read-only, firmware writes to UCSR0A must not clear it
+    if (uart_empty == NEVER)
+        UCSR0A |= _BV(UDRE0);
+
+    if (enabled && (UCSR0A & _BV(UDRE0)))
+        raise(V_USART_UDRE);
+}
+
+/**********************************************************************
+ * Function: eeprom_poll()
+ * Purpose:  Latch address and data when EEPE is set together with
+ *           EEMPE, program the cell 3.4 ms later and raise EEPROM ready
+ *           interrupt while no write is running.
+ **********************************************************************/
+static void eeprom_poll(void)
+{
+    if (eeprom_done == NEVER && (EECR & _BV(EEPE))) {
+        if (EECR & _BV(EEMPE)) {
+            eeprom_address = EEAR & (HAL_EEPROM_SIZE - 1);
+            eeprom_data = hal_io[0x40];
+            eeprom_done = now + HAL_EEPROM_WRITE_CYCLES;
+            // Master enable times out after four cycles
+            EECR &= ~_BV(EEMPE);
+        }
+        else {
+            EECR &= ~_BV(EEPE);
+        }
+    }
+    else if (eeprom_done <= now) {
+        eeprom[eeprom_address] = eeprom_data;
+        eeprom_done = NEVER;
+        EECR &= ~_BV(EEPE);
+    }
+
+    if (!(EECR & _BV(EEPE)))
+        raise(V_EE_READY);
+}
+
+/**********************************************************************
+ * Function: eeprom_wait()
+ * Purpose:  Busy wait until a running EEPROM write finishes.
+ **********************************************************************/
+static void eeprom_wait(void)
+{
+    eeprom_poll();
+    while (eeprom_done != NEVER) {
+        hal_delay_cycles(eeprom_done - now);
+        eeprom_poll();
+    }
+}
+
+/**********************************************************************
+ * Function: input_changed()
+ * Purpose:  Latch external and pin change interrupts for changed pins.
+ **********************************************************************/
+static void input_changed(uint8_t port, uint8_t old_pin, uint8_t new_pin)
+{
+    static const uint8_t pcmsk[HAL_PORTS] = {0x6B, 0x6C, 0x6D};
+    uint8_t changed = old_pin ^ new_pin;
+
+    if (changed & hal_io[pcmsk[port]])
+        raise(V_PCINT0 + port);
+
+    if (port == HAL_PORT_D) {
+        for (uint8_t i = 0; i < 2; i++) {
+            uint8_t bit = _BV(PD2 + i);
+            uint8_t sense = (EICRA >> (2 * i)) & 0x03;
+
+            if (!(changed & bit))
+                continue;
+            if (sense == 0x01 ||
+                (sense == 0x02 && !(new_pin & bit)) ||
+                (sense == 0x03 && (new_pin & bit)) ||
+                (sense == 0x00 && !(new_pin & bit)))
+                raise(V_INT0 + i);
+        }
+    }
+}
+
+/**********************************************************************
+ * Function: sync_pins()
+ * Purpose:  Publish output changes to hooks and refresh PINx registers.
+ *           Writing one to an output bit of PINx toggles PORTx like on
+ *           the MCU. Output bits are published as 0, so any such write
+ *           differs from the published value. The firmware reads input
+ *           pins only.
+ **********************************************************************/
+static void sync_pins(void)
+{
+    for (uint8_t port = 0; port < HAL_PORTS; port++) {
+        uint8_t output;
+        uint8_t pin;
+
+        PORTX(port) ^= (PINX(port) ^ published_pin[port]) & DDRX(port);
+        output = PORTX(port) & DDRX(port);
+
+        if (output != last_output[port]) {
+            uint8_t old = last_output[port];
+
+            last_output[port] = output;
+            for (uint8_t i = 0; i < port_hook_count; i++)
+                port_hooks[i](port, old, output);
+        }
+
+        pin = output | (ext_level[port] & ~DDRX(port));
+        if (pin != last_pin[port]) {
+            input_changed(port, last_pin[port], pin);
+            last_pin[port] = pin;
+        }
+        published_pin[port] = pin & ~DDRX(port);
+        PINX(port) = published_pin[port];
+    }
+}
+
+/**********************************************************************
+ * Function: consume()
+ * Purpose:  Let timers run while the CPU is busy in an interrupt, their
+ *           events are latched and served after it.
+ **********************************************************************/
+static void consume(uint64_t cycles)
+{
+    for (uint8_t i = 0; i < TIMERS; i++)
+        timer_step(&timers[i], cycles);
+    now += cycles;
+}
+
+/**********************************************************************
+ * Function: dispatch()
+ * Purpose:  Run pending interrupt service routines in priority order
+ *           while global interrupts are enabled.
+ * Returns:  Number of ISRs run
+ **********************************************************************/
+static uint32_t dispatch(void)
+{
+    uint32_t ran = 0;
+
+    while ((SREG & _BV(SREG_I)) && pending) {
+        vector_id_t v = 0;
+
+        while (!(pending & (1UL<<v)))
+            ++v;
+        pending &= ~(1UL<<v);
+
+        if (!vectors[v].isr || !(hal_io[vectors[v].mask_reg] & _BV(vectors[v].mask_bit)))
+            continue;
+
+        // Hardware clears I bit on entry and RETI sets it again
+        cli();
+        ++isr_count;
+        ++ran;
+        ++isr_depth;
+        consume(ISR_ENTRY_CYCLES);
+        vectors[v].isr();
+        consume(ISR_BODY_CYCLES);
+        --isr_depth;
+        sync_pins();
+        uart_poll();
+        eeprom_poll();
+        sei();
+    }
+
+    return ran;
+}
+
+/**********************************************************************
+ * Function: next_event()
+ * Purpose:  Absolute time of the nearest timer or external event.
+ **********************************************************************/
+static uint64_t next_event(void)
+{
+    uint64_t best = end;
+
+    adc_poll();
+    if (adc_done < best)
+        best = adc_done;
+    uart_poll();
+    if (uart_empty < best)
+        best = uart_empty;
+    eeprom_poll();
+    if (eeprom_done < best)
+        best = eeprom_done;
+
+    for (uint8_t i = 0; i < TIMERS; i++) {
+        uint64_t d = timer_next_event(&timers[i]);
+        if (d != NEVER && now + d < best)
+            best = now + d;
+    }
+    for (uint8_t i = 0; i < event_count; i++) {
+        if (events[i].at < best)
+            best = events[i].at;
+    }
+
+    return best > now ? best : now + 1;
+}
+
+/**********************************************************************
+ * Function: run_due_events()
+ * Purpose:  Call scheduled external events whose time has come.
+ **********************************************************************/
+static void run_due_events(void)
+{
+    uint8_t found = 1;
+
+    while (found) {
+        found = 0;
+        for (uint8_t i = 0; i < event_count; i++) {
+            if (events[i].at <= now) {
+                scheduled_t due = events[i];
+
+                events[i] = events[--event_count];
+                due.event(due.context);
+                found = 1;
+                break;
+            }
+        }
+    }
+}
+
+/**********************************************************************
+ * Function: wdt_check()
+ * Purpose:  End the run when the enabled watchdog was not restarted
+ *           within its timeout of 2048 << WDP cycles of 128 kHz.
+ **********************************************************************/
+static void wdt_check(void)
+{
+    uint8_t wdtcsr = WDTCSR;
+    uint8_t prescaler = (wdtcsr & 0x07) | ((wdtcsr & _BV(WDP3)) ? 0x08 : 0);
+    uint64_t timeout = HAL_CYCLES_MS(16) << prescaler;
+
+    if (!(wdtcsr & _BV(WDE)) || now - wdt_kicked <= timeout)
+        return;
+
+    fprintf(stderr, "watchdog reset at %.3f s\n", (double)now / HAL_F_CPU);
+    MCUSR |= _BV(WDRF);
+    longjmp(exit_point, 1);
+}
+
+/**********************************************************************
+ * Function: advance()
+ * Purpose:  Move simulated time forward event by event.
+ **********************************************************************/
+static void advance(uint64_t target)
+{
+    while (now < target) {
+        uint64_t next;
+
+        // Prescaler reset of Timer/Counter2, the bit clears itself
+        if (GTCCR & _BV(PSRASY)) {
+            timers[2].phase = 0;
+            GTCCR &= ~_BV(PSRASY);
+        }
+
+        next = next_event();
+
+        if (next > target)
+            next = target;
+
+        for (uint8_t i = 0; i < TIMERS; i++)
+            timer_step(&timers[i], next - now);
+        now = next;
+
+        run_due_events();
+        adc_poll();
+        uart_poll();
+        eeprom_poll();
+        sync_pins();
+        dispatch();
+        wdt_check();
+
+        if (now >= end)
+            longjmp(exit_point, 1);
+    }
+}
+
+/**********************************************************************
+ * Function: hal_init()
+ * Purpose:  Reset registers and simulated time.
+ **********************************************************************/
+void hal_init(uint64_t end_cycle)
+{
+    for (uint16_t i = 0; i < sizeof(hal_io); i++)
+        hal_io[i] = 0;
+    for (uint8_t i = 0; i < TIMERS; i++)
+        timers[i].phase = 0;
+    for (uint8_t port = 0; port < HAL_PORTS; port++) {
+        ext_level[port] = 0;
+        last_output[port] = 0;
+        last_pin[port] = 0;
+        published_pin[port] = 0;
+    }
+
+    for (uint16_t i = 0; i < HAL_EEPROM_SIZE; i++)
+        eeprom[i] = 0xFF;
+    eeprom_done = NEVER;
+
+    for (uint8_t i = 0; i < HAL_ADC_CHANNELS; i++)
+        adc_inputs[i] = 0;
+    adc_done = NEVER;
+
+    UCSR0A = _BV(UDRE0);
+    uart_written = 0;
+    uart_empty = NEVER;
+
+    wdt_kicked = 0;
+
+    now = 0;
+    end = end_cycle;
+    pending = 0;
+    isr_count = 0;
+    isr_depth = 0;
+    delay_depth = 0;
+    event_count = 0;
+}
+
+/**********************************************************************
+ * Function: hal_run()
+ * Purpose:  Run firmware until simulated time reaches the end.
+ **********************************************************************/
+void hal_run(int (*entry)(void))
+{
+    if (setjmp(exit_point) == 0)
+        entry();
+}
+
+uint64_t hal_now(void)
+{
+    return now;
+}
+
+uint64_t hal_isr_count(void)
+{
+    return isr_count;
+}
+
+uint8_t hal_in_isr(void)
+{
+    return isr_depth != 0;
+}
+
+uint8_t hal_delay_depth(void)
+{
+    return delay_depth;
+}
+
+/**********************************************************************
+ * Function: hal_delay_cycles()
+ * Purpose:  Busy wait, pending interrupts run during the wait.
+ **********************************************************************/
+void hal_delay_cycles(uint64_t cycles)
+{
+    ++delay_depth;
+    for (uint8_t i = 0; i < delay_hook_count; i++)
+        delay_hooks[i]();
+
+    sync_pins();
+    dispatch();
+    advance(now + cycles);
+    --delay_depth;
+}
+
+/**********************************************************************
+ * Function: hal_idle()
+ * Purpose:  Nothing to do in main loop, jump to the next event unless
+ *           an interrupt is already pending.
+ **********************************************************************/
+void hal_idle(void)
+{
+    sync_pins();
+    if (dispatch())
+        return;
+
+    advance(next_event());
+}
+
+void hal_wdt_reset(void)
+{
+    wdt_kicked = now;
+}
+
+volatile uint8_t *hal_udr0(void)
+{
+    uart_written = 1;
+    return &hal_io[0xC6];
+}
+
+void hal_set_input(uint8_t port, uint8_t pin, uint8_t level)
+{
+    if (level)
+        ext_level[port] |= _BV(pin);
+    else
+        ext_level[port] &= ~_BV(pin);
+
+    sync_pins();
+}
+
+void hal_set_adc(uint8_t channel, uint16_t value)
+{
+    if (channel < HAL_ADC_CHANNELS)
+        adc_inputs[channel] = value;
+}
+
+uint8_t hal_get_output(uint8_t port)
+{
+    return PORTX(port) & DDRX(port);
+}
+
+void hal_schedule(uint64_t at, hal_event_t event, void *context)
+{
+    if (event_count >= HAL_EVENTS)
+        abort();
+
+    events[event_count].at = at;
+    events[event_count].event = event;
+    events[event_count].context = context;
+    ++event_count;
+}
+
+void hal_add_port_hook(hal_port_hook_t hook)
+{
+    if (port_hook_count < HAL_HOOKS)
+        port_hooks[port_hook_count++] = hook;
+}
+
+void hal_add_delay_hook(hal_delay_hook_t hook)
+{
+    if (delay_hook_count < HAL_HOOKS)
+        delay_hooks[delay_hook_count++] = hook;
+}
+
+volatile uint8_t *hal_eedr(void)
+{
+    // Read strobe loads the data register at once
+    if (EECR & _BV(EERE)) {
+        hal_io[0x40] = eeprom[EEAR & (HAL_EEPROM_SIZE - 1)];
+        EECR &= ~_BV(EERE);
+    }
+    return &hal_io[0x40];
+}
+
+uint8_t *hal_eeprom(void)
+{
+    return eeprom;
+}
+
+void hal_add_uart_hook(hal_uart_hook_t hook)
+{
+    if (uart_hook_count < HAL_HOOKS)
+        uart_hooks[uart_hook_count++] = hook;
+}
+
+/* avr-libc compatibility --------------------------------------------*/
+void _delay_us(double us)
+{
+    hal_delay_cycles((uint64_t)(us * (HAL_F_CPU / 1000000ULL) + 0.5));
+}
+
+void _delay_ms(double ms)
+{
+    hal_delay_cycles((uint64_t)(ms * (HAL_F_CPU / 1000ULL) + 0.5));
+}
+
+// Address of EEPROM cell passed as pointer, wraps like the hardware
+#define EEPROM_CELL(addr) eeprom[(uintptr_t)(addr) & (HAL_EEPROM_SIZE - 1)]
+
+uint8_t eeprom_is_ready(void)
+{
+    eeprom_poll();
+    return eeprom_done == NEVER;
+}
+
+uint8_t eeprom_read_byte(const uint8_t *addr)
+{
+    eeprom_wait();
+    return EEPROM_CELL(addr);
+}
+
+uint16_t eeprom_read_word(const uint16_t *addr)
+{
+    return eeprom_read_byte((const uint8_t *)addr) |
+           (eeprom_read_byte((const uint8_t *)addr + 1) << 8);
+}
+
+void eeprom_read_block(void *dst, const void *src, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        ((uint8_t *)dst)[i] = eeprom_read_byte((const uint8_t *)src + i);
+}
+
+void eeprom_write_byte(uint8_t *addr, uint8_t value)
+{
+    // Like avr-libc wait for the previous write, not for this one
+    eeprom_wait();
+    EEAR = (uintptr_t)addr & (HAL_EEPROM_SIZE - 1);
+    hal_io[0x40] = value;
+    EECR |= _BV(EEMPE) | _BV(EEPE);
+    eeprom_poll();
+}
+
+void eeprom_update_byte(uint8_t *addr, uint8_t value)
+{
+    if (EEPROM_CELL(addr) != value)
+        eeprom_write_byte(addr, value);
+}
+
+void eeprom_update_word(uint16_t *addr, uint16_t value)
+{
+    eeprom_update_byte((uint8_t *)addr, value & 0xFF);
+    eeprom_update_byte((uint8_t *)addr + 1, value >> 8);
+}
+
+void eeprom_update_block(const void *src, void *dst, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        eeprom_update_byte((uint8_t *)dst + i, ((const uint8_t *)src)[i]);
+}
+
+char *utoa(unsigned int value, char *s, int radix)
+{
+    char buffer[8 * sizeof(int)];
+    char *p = buffer;
+    char *out = s;
+
+    do {
+        unsigned int digit = value % radix;
+        *p++ = digit < 10 ? '0' + digit : 'a' + digit - 10;
+        value /= radix;
+    } while (value);
+
+    while (p != buffer)
+        *out++ = *--p;
+    *out = '\0';
+
+    return s;
+}
+
+char *itoa(int value, char *s, int radix)
+{
+    if (value < 0 && radix == 10) {
+        *s = '-';
+        utoa(-(unsigned int)value, s + 1, radix);
+        return s;
+    }
+
+    return utoa((unsigned int)value, s, radix);
+}
@@ -0,0 +1,183 @@
+#ifndef HAL_H_
+#define HAL_H_
+
+/***********************************************************************
+ *
+ * Simulated ATmega328P core for host build of the firmware.
+ * Linux, GCC
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/**
+ * @file
+ * @defgroup hal Simulated MCU core <hal.h>
+ * @code #include "hal.h" @endcode
+ *
+ * @brief Event driven simulation of the MCU peripherals the firmware
+ *        uses.
+ *
+ * Simulated time only advances when the firmware waits, i.e. inside
+ * _delay_us()/_delay_ms() and hal_idle(), so code between waits takes
+ * zero time. Only every interrupt occupies the CPU for a fixed number
+ * of cycles, so timer interrupts which meet a running one are late
+ * like on the MCU. Time jumps straight to the next timer or external event,
+ * which is what makes the simulation run thousands of times faster
+ * than real time. Timer/Counter0..2 (normal and CTC mode), external
+ * interrupts INT0/INT1, pin change interrupts, single conversions
+ * of the ADC, the USART0 transmitter and the data EEPROM are
+ * modelled.
+ * Peripheral models (LCD, sensor, tank) observe output pins through
+ * hooks and drive input pins with hal_set_input().
+ *
+ * @{
+ */
+
+/* Includes ----------------------------------------------------------*/
+#include <stdint.h>
+#include <avr/io.h>
+
+/* Defines -----------------------------------------------------------*/
+#define HAL_F_CPU        16000000ULL // Simulated clock frequency in Hz
+#define HAL_CYCLES_US(us) ((uint64_t)(us) * (HAL_F_CPU / 1000000ULL))
+#define HAL_CYCLES_MS(ms) ((uint64_t)(ms) * (HAL_F_CPU / 1000ULL))
+#define HAL_PORT_B       0
+#define HAL_PORT_C       1
+#define HAL_PORT_D       2
+#define HAL_PORTS        3
+#define HAL_EVENTS       16          // Max scheduled external events
+#define HAL_HOOKS        8           // Max hooks of each kind
+#define HAL_ADC_CHANNELS 16          // ADMUX channel selections
+#define HAL_EEPROM_SIZE  1024        // Bytes of data EEPROM
+#define HAL_EEPROM_WRITE_CYCLES HAL_CYCLES_US(3400) // Erase and write
+
+/* Types -------------------------------------------------------------*/
+/** @brief Called when output level of a port changes */
+typedef void (*hal_port_hook_t)(uint8_t port, uint8_t old_level, uint8_t new_level);
+/** @brief Called at the start of every busy-wait delay */
+typedef void (*hal_delay_hook_t)(void);
+/** @brief Called with every byte the USART starts to transmit */
+typedef void (*hal_uart_hook_t)(uint8_t data);
+/** @brief Scheduled external event */
+typedef void (*hal_event_t)(void *context);
+
+/* Function prototypes -----------------------------------------------*/
+/**
+ * @name Functions
+ */
+
+/**
+ * @brief  Reset registers and simulated time.
+ * @param  end Simulated cycle at which hal_run() returns.
+ * @return none
+ */
+void hal_init(uint64_t end);
+
+/**
+ * @brief  Run firmware entry point until simulated time reaches end.
+ * @param  entry Firmware main function.
+ * @return none
+ */
+void hal_run(int (*entry)(void));
+
+/**
+ * @brief  Current simulated time.
+ * @return Cycles since reset
+ */
+uint64_t hal_now(void);
+
+/**
+ * @brief  Advance simulated time, run due events and interrupts.
+ * @param  cycles Number of CPU cycles to wait.
+ * @return none
+ */
+void hal_delay_cycles(uint64_t cycles);
+
+/**
+ * @brief  Drive level of an input pin.
+ * @param  port  HAL_PORT_B, HAL_PORT_C or HAL_PORT_D.
+ * @param  pin   Pin number 0 to 7.
+ * @param  level 0 or 1.
+ * @return none
+ */
+void hal_set_input(uint8_t port, uint8_t pin, uint8_t level);
+
+/**
+ * @brief  Set result of conversions on an ADC channel.
+ * @param  channel ADMUX channel, 8 is the temperature sensor.
+ * @param  value   10-bit conversion result.
+ * @return none
+ */
+void hal_set_adc(uint8_t channel, uint16_t value);
+
+/**
+ * @brief  Output level of a port as seen by external circuits.
+ * @param  port HAL_PORT_B, HAL_PORT_C or HAL_PORT_D.
+ * @return PORTx masked by DDRx
+ */
+uint8_t hal_get_output(uint8_t port);
+
+/**
+ * @brief  Schedule an external event.
+ * @param  at      Absolute simulated cycle.
+ * @param  event   Function to call.
+ * @param  context Argument passed to the function.
+ * @return none
+ */
+void hal_schedule(uint64_t at, hal_event_t event, void *context);
+
+/**
+ * @brief  Register hook called on output level change of any port.
+ * @param  hook Function to call.
+ * @return none
+ */
+void hal_add_port_hook(hal_port_hook_t hook);
+
+/**
+ * @brief  Register hook called at the start of every delay.
+ * @param  hook Function to call.
+ * @return none
+ */
+void hal_add_delay_hook(hal_delay_hook_t hook);
+
+/**
+ * @brief  Content of the data EEPROM, erased to 0xFF by hal_init().
+ *         Cells are programmed through EEAR, EEDR and EECR or the
+ *         <avr/eeprom.h> functions, each write takes 3.4 ms.
+ * @return HAL_EEPROM_SIZE bytes, may be loaded and saved by the caller
+ */
+uint8_t *hal_eeprom(void);
+
+/**
+ * @brief  Register hook called with every byte sent by USART0.
+ * @param  hook Function to call.
+ * @return none
+ */
+void hal_add_uart_hook(hal_uart_hook_t hook);
+
+/**
+ * @brief  Number of interrupt service routines run so far.
+ * @return ISR count
+ */
+uint64_t hal_isr_count(void);
+
+/**
+ * @brief  Check whether an interrupt service routine is running.
+ * @return 1 inside ISR, 0 in main context
+ */
+uint8_t hal_in_isr(void);
+
+/**
+ * @brief  Number of delays in progress, a delay of an interrupt service
+ *         routine which preempted another delay counts two.
+ * @return 0 outside delays, 1 in the outermost one
+ */
+uint8_t hal_delay_depth(void);
+
+/** @} */
+
+#endif /* HAL_H_ */
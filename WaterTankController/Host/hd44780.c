@@ -0,0 +1,163 @@
+/***********************************************************************
+ *
+ * HD44780 LCD model for host build of the firmware.
+ * Linux, GCC
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/* Includes ----------------------------------------------------------*/
+#include "hal.h"
+#include "hd44780.h"
+
+/* Defines -----------------------------------------------------------*/
+#define RS_PIN  PB0
+#define E_PIN   PB1
+#define EXECUTE_CYCLES HAL_CYCLES_US(37)    // Most instructions and data
+#define CLEAR_CYCLES   HAL_CYCLES_US(1520)  // Clear display, return home
+
+/* Variables ---------------------------------------------------------*/
+static uint8_t ddram[0x80];
+static uint8_t cgram[0x40];
+static uint8_t address;
+static uint8_t cgram_selected;
+static uint8_t four_bit;
+static uint8_t high_nibble;
+static uint8_t nibble_pending;
+static uint32_t bytes;
+static uint32_t busy_writes;
+static uint64_t busy_until;
+// Bit n set while delay at depth n + 1 is an enable pulse
+static uint8_t pulses;
+
+/* Function definitions ----------------------------------------------*/
+/**********************************************************************
+ * Function: execute()
+ * Purpose:  Execute complete instruction or data byte.
+ **********************************************************************/
+static void execute(uint8_t value, uint8_t rs)
+{
+    ++bytes;
+
+    // Controller still executes the previous byte, real one may drop it
+    if (hal_now() < busy_until)
+        ++busy_writes;
+    busy_until = hal_now() + EXECUTE_CYCLES;
+
+    if (rs) {
+        if (cgram_selected) {
+            cgram[address & 0x3F] = value;
+            address = (address + 1) & 0x3F;
+        }
+        else {
+            ddram[address & 0x7F] = value;
+            address = (address + 1) & 0x7F;
+        }
+        return;
+    }
+
+    if (value & 0x80) {
+        cgram_selected = 0;
+        address = value & 0x7F;
+    }
+    else if (value & 0x40) {
+        cgram_selected = 1;
+        address = value & 0x3F;
+    }
+    else if (value & 0x20) {
+        // Function set, DL bit selects interface width
+        four_bit = !(value & 0x10);
+    }
+    else if (value == 0x01) {
+        for (uint8_t i = 0; i < sizeof(ddram); i++)
+            ddram[i] = ' ';
+        address = 0;
+        cgram_selected = 0;
+        busy_until = hal_now() + CLEAR_CYCLES;
+    }
+    else if ((value & 0xFE) == 0x02) {
+        address = 0;
+        cgram_selected = 0;
+        busy_until = hal_now() + CLEAR_CYCLES;
+    }
+}
+
+/**********************************************************************
+ * Function: on_delay()
+ * Purpose:  Latch bus when the delay belongs to an enable pulse.
+ **********************************************************************/
+static void on_delay(void)
+{
+    uint8_t control = hal_get_output(HAL_PORT_B);
+    uint8_t nibble = hal_get_output(HAL_PORT_D) >> 4;
+    uint8_t rs = (control >> RS_PIN) & 1;
+    uint8_t depth = hal_delay_depth();
+
+    // Delays at this depth and deeper have ended
+    pulses &= (1 << (depth - 1)) - 1;
+
+    // Delays of an ISR which preempted the pulse are not enable pulses,
+    // the asynchronous driver pulses E from its own ISR
+    if (!(control & _BV(E_PIN)) || pulses)
+        return;
+    pulses |= 1 << (depth - 1);
+
+    if (!four_bit) {
+        // 8-bit interface, only D7..D4 are wired
+        execute(nibble << 4, rs);
+        return;
+    }
+
+    if (!nibble_pending) {
+        high_nibble = nibble;
+        nibble_pending = 1;
+    }
+    else {
+        nibble_pending = 0;
+        execute((high_nibble << 4) | nibble, rs);
+    }
+}
+
+void hd44780_init(void)
+{
+    for (uint8_t i = 0; i < sizeof(ddram); i++)
+        ddram[i] = ' ';
+    for (uint8_t i = 0; i < sizeof(cgram); i++)
+        cgram[i] = 0;
+
+    address = 0;
+    cgram_selected = 0;
+    four_bit = 0;
+    nibble_pending = 0;
+    bytes = 0;
+    busy_writes = 0;
+    busy_until = 0;
+    pulses = 0;
+
+    hal_add_delay_hook(on_delay);
+}
+
+void hd44780_line(uint8_t row, char *text)
+{
+    uint8_t start = row ? 0x40 : 0x00;
+
+    for (uint8_t i = 0; i < HD44780_COLS; i++) {
+        uint8_t c = ddram[start + i];
+        text[i] = (c < 0x08) ? '#' : (c < 0x20 || c > 0x7E) ? '?' : c;
+    }
+    text[HD44780_COLS] = '\0';
+}
+
+uint32_t hd44780_bytes(void)
+{
+    return bytes;
+}
+
+uint32_t hd44780_busy_writes(void)
+{
+    return busy_writes;
+}
@@ -0,0 +1,72 @@
+#ifndef HD44780_H_
+#define HD44780_H_
+
+/***********************************************************************
+ *
+ * HD44780 LCD model for host build of the firmware.
+ * Linux, GCC
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/**
+ * @file
+ * @defgroup hd44780 HD44780 LCD model <hd44780.h>
+ * @code #include "hd44780.h" @endcode
+ *
+ * @brief Decodes 4-bit bus writes of the Fleury driver.
+ *
+ * The pins follow lcd_definitions.h: D4..D7 on PD4..PD7, RS on PB0 and
+ * E on PB1. The enable pulse is always followed by lcd_e_delay(), so
+ * the model latches the bus at every delay that starts with E high.
+ * Every byte keeps the controller busy for 37 us, clear display and
+ * return home for 1.52 ms. Bytes which arrive earlier are counted.
+ *
+ * @{
+ */
+
+/* Includes ----------------------------------------------------------*/
+#include <stdint.h>
+
+/* Defines -----------------------------------------------------------*/
+#define HD44780_COLS 16
+#define HD44780_ROWS 2
+
+/* Function prototypes -----------------------------------------------*/
+/**
+ * @name Functions
+ */
+
+/**
+ * @brief  Reset controller state and register bus hooks.
+ * @return none
+ */
+void hd44780_init(void);
+
+/**
+ * @brief  Copy visible line, custom characters are shown as '#'.
+ * @param  row  Line 0 or 1.
+ * @param  text Buffer for HD44780_COLS characters and terminator.
+ * @return none
+ */
+void hd44780_line(uint8_t row, char *text);
+
+/**
+ * @brief  Number of bytes written to the controller.
+ * @return Instruction and data byte count
+ */
+uint32_t hd44780_bytes(void);
+
+/**
+ * @brief  Number of bytes written while the controller was busy.
+ * @return Byte count, 0 if the driver kept the timing
+ */
+uint32_t hd44780_busy_writes(void);
+
+/** @} */
+
+#endif /* HD44780_H_ */
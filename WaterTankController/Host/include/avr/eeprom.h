@@ -0,0 +1,49 @@
+#ifndef HAL_AVR_EEPROM_H
+#define HAL_AVR_EEPROM_H
+
+/***********************************************************************
+ *
+ * Host replacement of <avr/eeprom.h> for the simulated ATmega328P.
+ * Linux, GCC
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/**
+ * @file
+ * @defgroup hal_eeprom EEPROM handling <avr/eeprom.h>
+ *
+ * @brief EEPROM addresses are passed as pointers like on the MCU and
+ *        must be fixed numbers, EEMEM variables are not supported.
+ *        Like in avr-libc a write waits for the previous one, so
+ *        every written byte after the first costs 3.4 ms of busy wait.
+ *
+ * @{
+ */
+
+/* Includes ----------------------------------------------------------*/
+#include <stddef.h>
+#include <stdint.h>
+#include <avr/io.h>
+
+/* Defines -----------------------------------------------------------*/
+#define E2END 0x3FF
+#define eeprom_busy_wait() do {} while (!eeprom_is_ready())
+
+/* Function prototypes -----------------------------------------------*/
+uint8_t eeprom_is_ready(void);
+uint8_t eeprom_read_byte(const uint8_t *addr);
+uint16_t eeprom_read_word(const uint16_t *addr);
+void eeprom_read_block(void *dst, const void *src, size_t n);
+void eeprom_write_byte(uint8_t *addr, uint8_t value);
+void eeprom_update_byte(uint8_t *addr, uint8_t value);
+void eeprom_update_word(uint16_t *addr, uint16_t value);
+void eeprom_update_block(const void *src, void *dst, size_t n);
+
+/** @} */
+
+#endif /* HAL_AVR_EEPROM_H */
@@ -0,0 +1,41 @@
+#ifndef HAL_AVR_INTERRUPT_H
+#define HAL_AVR_INTERRUPT_H
+
+/***********************************************************************
+ *
+ * Host replacement of <avr/interrupt.h> for the simulated ATmega328P.
+ * Linux, GCC
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/**
+ * @file
+ * @defgroup hal_interrupt Simulated interrupts <avr/interrupt.h>
+ *
+ * @brief Global interrupt flag and ISR declarations.
+ *
+ * ISR() declares an ordinary function named after the vector, see
+ * <avr/io.h>. The simulator calls it when the interrupt flag, the
+ * interrupt mask and the I bit in SREG are all set.
+ *
+ * @{
+ */
+
+/* Includes ----------------------------------------------------------*/
+#include <avr/io.h>
+
+/* Defines -----------------------------------------------------------*/
+#define sei() (SREG |= _BV(SREG_I))
+#define cli() (SREG &= ~_BV(SREG_I))
+#define ISR(vector, ...) void vector(void)
+#define ISR_BLOCK
+#define ISR_NOBLOCK
+
+/** @} */
+
+#endif /* HAL_AVR_INTERRUPT_H */
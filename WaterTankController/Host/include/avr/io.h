@@ -0,0 +1,389 @@
+#ifndef HAL_AVR_IO_H
+#define HAL_AVR_IO_H
+
+/***********************************************************************
+ *
+ * Host replacement of <avr/io.h> for the simulated ATmega328P.
+ * Linux, GCC
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/**
+ * @file
+ * @defgroup hal_io Simulated registers <avr/io.h>
+ *
+ * @brief Memory mapped registers of the simulated ATmega328P.
+ *
+ * All registers live in one array indexed by their data memory
+ * address, so the pointer arithmetic used by the firmware (DDRx is one
+ * byte below PORTx, PINx two bytes below) keeps working on the host.
+ *
+ * @{
+ */
+
+/* Includes ----------------------------------------------------------*/
+#include <stdint.h>
+
+/* Variables ---------------------------------------------------------*/
+// Register file of the simulated MCU indexed by data memory address
+extern volatile uint8_t hal_io[0x100];
+
+/* Defines -----------------------------------------------------------*/
+#define _SFR_MEM8(addr)  (hal_io[(addr)])
+#define _SFR_MEM16(addr) (*(volatile uint16_t *)&hal_io[(addr)])
+#define _SFR_IO8(addr)   _SFR_MEM8((addr) + 0x20)
+#define _BV(bit)         (1 << (bit))
+
+#define bit_is_set(sfr, bit)   ((sfr) & _BV(bit))
+#define bit_is_clear(sfr, bit) (!((sfr) & _BV(bit)))
+#define loop_until_bit_is_set(sfr, bit)   do { } while (bit_is_clear(sfr, bit))
+#define loop_until_bit_is_clear(sfr, bit) do { } while (bit_is_set(sfr, bit))
+
+/** @name Ports */
+#define PINB   _SFR_MEM8(0x23)
+#define DDRB   _SFR_MEM8(0x24)
+#define PORTB  _SFR_MEM8(0x25)
+#define PINC   _SFR_MEM8(0x26)
+#define DDRC   _SFR_MEM8(0x27)
+#define PORTC  _SFR_MEM8(0x28)
+#define PIND   _SFR_MEM8(0x29)
+#define DDRD   _SFR_MEM8(0x2A)
+#define PORTD  _SFR_MEM8(0x2B)
+
+#define PB0 0
+#define PB1 1
+#define PB2 2
+#define PB3 3
+#define PB4 4
+#define PB5 5
+#define PB6 6
+#define PB7 7
+#define PC0 0
+#define PC1 1
+#define PC2 2
+#define PC3 3
+#define PC4 4
+#define PC5 5
+#define PC6 6
+#define PD0 0
+#define PD1 1
+#define PD2 2
+#define PD3 3
+#define PD4 4
+#define PD5 5
+#define PD6 6
+#define PD7 7
+#define PINB0 0
+#define PINB1 1
+#define PINB2 2
+#define PINB3 3
+#define PINB4 4
+#define PINB5 5
+#define PINB6 6
+#define PINB7 7
+#define PINC0 0
+#define PINC1 1
+#define PINC2 2
+#define PINC3 3
+#define PINC4 4
+#define PINC5 5
+#define PINC6 6
+#define PIND0 0
+#define PIND1 1
+#define PIND2 2
+#define PIND3 3
+#define PIND4 4
+#define PIND5 5
+#define PIND6 6
+#define PIND7 7
+
+/** @name Interrupt flags and masks */
+#define TIFR0  _SFR_MEM8(0x35)
+#define TIFR1  _SFR_MEM8(0x36)
+#define TIFR2  _SFR_MEM8(0x37)
+#define PCIFR  _SFR_MEM8(0x3B)
+#define EIFR   _SFR_MEM8(0x3C)
+#define EIMSK  _SFR_MEM8(0x3D)
+#define PCICR  _SFR_MEM8(0x68)
+#define EICRA  _SFR_MEM8(0x69)
+#define PCMSK0 _SFR_MEM8(0x6B)
+#define PCMSK1 _SFR_MEM8(0x6C)
+#define PCMSK2 _SFR_MEM8(0x6D)
+#define TIMSK0 _SFR_MEM8(0x6E)
+#define TIMSK1 _SFR_MEM8(0x6F)
+#define TIMSK2 _SFR_MEM8(0x70)
+
+#define INT0   0
+#define INT1   1
+#define INTF0  0
+#define INTF1  1
+#define ISC00  0
+#define ISC01  1
+#define ISC10  2
+#define ISC11  3
+#define PCIE0  0
+#define PCIE1  1
+#define PCIE2  2
+#define PCIF0  0
+#define PCIF1  1
+#define PCIF2  2
+#define PCINT0  0
+#define PCINT1  1
+#define PCINT2  2
+#define PCINT3  3
+#define PCINT4  4
+#define PCINT5  5
+#define PCINT6  6
+#define PCINT7  7
+#define PCINT8  0
+#define PCINT9  1
+#define PCINT10 2
+#define PCINT11 3
+#define PCINT12 4
+#define PCINT13 5
+#define PCINT14 6
+#define PCINT16 0
+#define PCINT17 1
+#define PCINT18 2
+#define PCINT19 3
+#define PCINT20 4
+#define PCINT21 5
+#define PCINT22 6
+#define PCINT23 7
+#define TOIE0  0
+#define OCIE0A 1
+#define OCIE0B 2
+#define TOV0   0
+#define OCF0A  1
+#define OCF0B  2
+#define TOIE1  0
+#define OCIE1A 1
+#define OCIE1B 2
+#define ICIE1  5
+#define TOV1   0
+#define OCF1A  1
+#define OCF1B  2
+#define ICF1   5
+#define TOIE2  0
+#define OCIE2A 1
+#define OCIE2B 2
+#define TOV2   0
+#define OCF2A  1
+#define OCF2B  2
+#define PSRASY 1
+
+/** @name General purpose registers */
+#define GPIOR0 _SFR_MEM8(0x3E)
+#define GPIOR1 _SFR_MEM8(0x4A)
+#define GPIOR2 _SFR_MEM8(0x4B)
+
+/** @name EEPROM */
+#define EECR   _SFR_MEM8(0x3F)
+// Data register goes through the simulator to serve the read strobe
+#define EEDR   (*hal_eedr())
+#define EEARL  _SFR_MEM8(0x41)
+#define EEARH  _SFR_MEM8(0x42)
+#define EEAR   _SFR_MEM16(0x41)
+#define EERE   0
+#define EEPE   1
+#define EEMPE  2
+#define EERIE  3
+#define EEPM0  4
+#define EEPM1  5
+#define E2END  0x3FF
+
+/** @name Timer/Counter0 */
+#define GTCCR  _SFR_MEM8(0x43)
+#define TCCR0A _SFR_MEM8(0x44)
+#define TCCR0B _SFR_MEM8(0x45)
+#define TCNT0  _SFR_MEM8(0x46)
+#define OCR0A  _SFR_MEM8(0x47)
+#define OCR0B  _SFR_MEM8(0x48)
+#define WGM00  0
+#define WGM01  1
+#define COM0B0 4
+#define COM0B1 5
+#define COM0A0 6
+#define COM0A1 7
+#define CS00   0
+#define CS01   1
+#define CS02   2
+#define WGM02  3
+#define FOC0B  6
+#define FOC0A  7
+
+/** @name Sleep, reset and power control */
+#define SMCR   _SFR_MEM8(0x53)
+#define MCUSR  _SFR_MEM8(0x54)
+#define MCUCR  _SFR_MEM8(0x55)
+#define SREG   _SFR_MEM8(0x5F)
+#define WDTCSR _SFR_MEM8(0x60)
+#define CLKPR  _SFR_MEM8(0x61)
+#define PRR    _SFR_MEM8(0x64)
+#define SREG_I 7
+#define SE     0
+#define SM0    1
+#define SM1    2
+#define SM2    3
+#define PORF   0
+#define EXTRF  1
+#define BORF   2
+#define WDRF   3
+#define PUD    4
+#define WDP0   0
+#define WDP1   1
+#define WDP2   2
+#define WDE    3
+#define WDCE   4
+#define WDP3   5
+#define WDIE   6
+#define WDIF   7
+#define PRADC    0
+#define PRUSART0 1
+#define PRSPI    2
+#define PRTIM1   3
+#define PRTIM0   5
+#define PRTIM2   6
+#define PRTWI    7
+
+/** @name Analog to digital converter */
+#define ADC    _SFR_MEM16(0x78)
+#define ADCL   _SFR_MEM8(0x78)
+#define ADCH   _SFR_MEM8(0x79)
+#define ADCSRA _SFR_MEM8(0x7A)
+#define ADCSRB _SFR_MEM8(0x7B)
+#define ADMUX  _SFR_MEM8(0x7C)
+#define DIDR0  _SFR_MEM8(0x7E)
+#define ADPS0  0
+#define ADPS1  1
+#define ADPS2  2
+#define ADIE   3
+#define ADIF   4
+#define ADATE  5
+#define ADSC   6
+#define ADEN   7
+#define MUX0   0
+#define MUX1   1
+#define MUX2   2
+#define MUX3   3
+#define ADLAR  5
+#define REFS0  6
+#define REFS1  7
+
+/** @name Timer/Counter1 */
+#define TCCR1A _SFR_MEM8(0x80)
+#define TCCR1B _SFR_MEM8(0x81)
+#define TCCR1C _SFR_MEM8(0x82)
+#define TCNT1  _SFR_MEM16(0x84)
+#define ICR1   _SFR_MEM16(0x86)
+#define OCR1A  _SFR_MEM16(0x88)
+#define OCR1B  _SFR_MEM16(0x8A)
+#define WGM10  0
+#define WGM11  1
+#define COM1B0 4
+#define COM1B1 5
+#define COM1A0 6
+#define COM1A1 7
+#define CS10   0
+#define CS11   1
+#define CS12   2
+#define WGM12  3
+#define WGM13  4
+#define ICES1  6
+#define ICNC1  7
+
+/** @name Timer/Counter2 */
+#define TCCR2A _SFR_MEM8(0xB0)
+#define TCCR2B _SFR_MEM8(0xB1)
+#define TCNT2  _SFR_MEM8(0xB2)
+#define OCR2A  _SFR_MEM8(0xB3)
+#define OCR2B  _SFR_MEM8(0xB4)
+#define ASSR   _SFR_MEM8(0xB6)
+#define WGM20  0
+#define WGM21  1
+#define COM2B0 4
+#define COM2B1 5
+#define COM2A0 6
+#define COM2A1 7
+#define CS20   0
+#define CS21   1
+#define CS22   2
+#define WGM22  3
+
+/** @name USART0 */
+#define UCSR0A _SFR_MEM8(0xC0)
+#define UCSR0B _SFR_MEM8(0xC1)
+#define UCSR0C _SFR_MEM8(0xC2)
+#define UBRR0  _SFR_MEM16(0xC4)
+#define UBRR0L _SFR_MEM8(0xC4)
+#define UBRR0H _SFR_MEM8(0xC5)
+// Data register goes through the simulator to notice every write
+#define UDR0   (*hal_udr0())
+#define MPCM0  0
+#define U2X0   1
+#define UPE0   2
+#define DOR0   3
+#define FE0    4
+#define UDRE0  5
+#define TXC0   6
+#define RXC0   7
+#define TXB80  0
+#define RXB80  1
+#define UCSZ02 2
+#define TXEN0  3
+#define RXEN0  4
+#define UDRIE0 5
+#define TXCIE0 6
+#define RXCIE0 7
+#define UCPOL0 0
+#define UCSZ00 1
+#define UCSZ01 2
+#define USBS0  3
+#define UPM00  4
+#define UPM01  5
+#define UMSEL00 6
+#define UMSEL01 7
+
+/** @name Simulator services used by host build of the firmware */
+/** @brief Advance simulated time to the next interrupt or event */
+void hal_idle(void);
+/** @brief USART0 data register, a write starts transmission */
+volatile uint8_t *hal_udr0(void);
+/** @brief EEPROM data register, loaded by EERE read strobe */
+volatile uint8_t *hal_eedr(void);
+/** @brief Restart watchdog timeout, WDR instruction */
+void hal_wdt_reset(void);
+/** @brief avr-libc extension of <stdlib.h> missing in glibc */
+char *itoa(int value, char *s, int radix);
+/** @brief avr-libc extension of <stdlib.h> missing in glibc */
+char *utoa(unsigned int value, char *s, int radix);
+
+/** @name Interrupt vectors, handled by simulator dispatch table */
+#define INT0_vect         hal_vector_int0
+#define INT1_vect         hal_vector_int1
+#define PCINT0_vect       hal_vector_pcint0
+#define PCINT1_vect       hal_vector_pcint1
+#define PCINT2_vect       hal_vector_pcint2
+#define WDT_vect          hal_vector_wdt
+#define TIMER2_COMPA_vect hal_vector_timer2_compa
+#define TIMER2_COMPB_vect hal_vector_timer2_compb
+#define TIMER2_OVF_vect   hal_vector_timer2_ovf
+#define TIMER1_COMPA_vect hal_vector_timer1_compa
+#define TIMER1_COMPB_vect hal_vector_timer1_compb
+#define TIMER1_OVF_vect   hal_vector_timer1_ovf
+#define TIMER0_COMPA_vect hal_vector_timer0_compa
+#define TIMER0_COMPB_vect hal_vector_timer0_compb
+#define TIMER0_OVF_vect   hal_vector_timer0_ovf
+#define USART_UDRE_vect   hal_vector_usart_udre
+#define USART_TX_vect     hal_vector_usart_tx
+#define ADC_vect          hal_vector_adc
+#define EE_READY_vect     hal_vector_ee_ready
+
+/** @} */
+
+#endif /* HAL_AVR_IO_H */
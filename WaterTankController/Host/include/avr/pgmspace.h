@@ -0,0 +1,43 @@
+#ifndef HAL_AVR_PGMSPACE_H
+#define HAL_AVR_PGMSPACE_H
+
+/***********************************************************************
+ *
+ * Host replacement of <avr/pgmspace.h> for the simulated ATmega328P.
+ * Linux, GCC
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/**
+ * @file
+ * @defgroup hal_pgmspace Program space utilities <avr/pgmspace.h>
+ *
+ * @brief Host has a single address space, flash data is plain const.
+ *
+ * @{
+ */
+
+/* Includes ----------------------------------------------------------*/
+#include <stdint.h>
+#include <string.h>
+
+/* Defines -----------------------------------------------------------*/
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+#define pgm_read_byte(addr)  (*(const uint8_t *)(addr))
+#define pgm_read_word(addr)  (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define pgm_read_ptr(addr)   (*(const void * const *)(addr))
+#define memcpy_P memcpy
+#define strcpy_P strcpy
+#define strlen_P strlen
+
+/** @} */
+
+#endif /* HAL_AVR_PGMSPACE_H */
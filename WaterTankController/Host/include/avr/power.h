@@ -0,0 +1,42 @@
+#ifndef HAL_AVR_POWER_H
+#define HAL_AVR_POWER_H
+
+/***********************************************************************
+ *
+ * Host replacement of <avr/power.h> for the simulated ATmega328P.
+ * Linux, GCC
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/**
+ * @file
+ * @defgroup hal_power Power reduction <avr/power.h>
+ *
+ * @brief Power reduction register access.
+ *
+ * @{
+ */
+
+/* Includes ----------------------------------------------------------*/
+#include <avr/io.h>
+
+/* Defines -----------------------------------------------------------*/
+#define power_adc_disable()    (PRR |= _BV(PRADC))
+#define power_adc_enable()     (PRR &= ~_BV(PRADC))
+#define power_usart0_disable() (PRR |= _BV(PRUSART0))
+#define power_usart0_enable()  (PRR &= ~_BV(PRUSART0))
+#define power_spi_disable()    (PRR |= _BV(PRSPI))
+#define power_spi_enable()     (PRR &= ~_BV(PRSPI))
+#define power_twi_disable()    (PRR |= _BV(PRTWI))
+#define power_twi_enable()     (PRR &= ~_BV(PRTWI))
+#define power_timer2_disable() (PRR |= _BV(PRTIM2))
+#define power_timer2_enable()  (PRR &= ~_BV(PRTIM2))
+
+/** @} */
+
+#endif /* HAL_AVR_POWER_H */
@@ -0,0 +1,47 @@
+#ifndef HAL_AVR_SLEEP_H
+#define HAL_AVR_SLEEP_H
+
+/***********************************************************************
+ *
+ * Host replacement of <avr/sleep.h> for the simulated ATmega328P.
+ * Linux, GCC
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/**
+ * @file
+ * @defgroup hal_sleep Simulated sleep modes <avr/sleep.h>
+ *
+ * @brief Sleeping lets simulated time jump to the next interrupt.
+ *
+ * Sleep mode only selects bits in SMCR, the simulator keeps all timers
+ * running in every mode.
+ *
+ * @{
+ */
+
+/* Includes ----------------------------------------------------------*/
+#include <avr/io.h>
+
+/* Defines -----------------------------------------------------------*/
+#define SLEEP_MODE_IDLE       (0)
+#define SLEEP_MODE_ADC        _BV(SM0)
+#define SLEEP_MODE_PWR_DOWN   _BV(SM1)
+#define SLEEP_MODE_PWR_SAVE   (_BV(SM0) | _BV(SM1))
+#define SLEEP_MODE_STANDBY    (_BV(SM1) | _BV(SM2))
+#define SLEEP_MODE_EXT_STANDBY (_BV(SM0) | _BV(SM1) | _BV(SM2))
+
+#define set_sleep_mode(mode) (SMCR = (SMCR & ~(_BV(SM0) | _BV(SM1) | _BV(SM2))) | (mode))
+#define sleep_enable()  (SMCR |= _BV(SE))
+#define sleep_disable() (SMCR &= ~_BV(SE))
+#define sleep_cpu()     do { if (SMCR & _BV(SE)) hal_idle(); } while (0)
+#define sleep_mode()    do { sleep_enable(); sleep_cpu(); sleep_disable(); } while (0)
+
+/** @} */
+
+#endif /* HAL_AVR_SLEEP_H */
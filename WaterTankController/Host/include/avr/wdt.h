@@ -0,0 +1,53 @@
+#ifndef HAL_AVR_WDT_H
+#define HAL_AVR_WDT_H
+
+/***********************************************************************
+ *
+ * Host replacement of <avr/wdt.h> for the simulated ATmega328P.
+ * Linux, GCC
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/**
+ * @file
+ * @defgroup hal_wdt Simulated watchdog timer <avr/wdt.h>
+ *
+ * @brief Watchdog in system reset mode.
+ *
+ * The simulator cannot restart the firmware, a watchdog timeout ends
+ * the run with a message instead.
+ *
+ * @{
+ */
+
+/* Includes ----------------------------------------------------------*/
+#include <avr/io.h>
+
+/* Defines -----------------------------------------------------------*/
+#define WDTO_15MS  0
+#define WDTO_30MS  1
+#define WDTO_60MS  2
+#define WDTO_120MS 3
+#define WDTO_250MS 4
+#define WDTO_500MS 5
+#define WDTO_1S    6
+#define WDTO_2S    7
+#define WDTO_4S    8
+#define WDTO_8S    9
+
+#define wdt_reset()  hal_wdt_reset()
+#define wdt_enable(value) \
+    do { \
+        hal_wdt_reset(); \
+        WDTCSR = _BV(WDE) | ((value) & 0x07) | (((value) & 0x08) ? _BV(WDP3) : 0); \
+    } while (0)
+#define wdt_disable() (WDTCSR = 0)
+
+/** @} */
+
+#endif /* HAL_AVR_WDT_H */
@@ -0,0 +1,59 @@
+#ifndef HAL_UTIL_ATOMIC_H
+#define HAL_UTIL_ATOMIC_H
+
+/***********************************************************************
+ *
+ * Host replacement of <util/atomic.h> for the simulated ATmega328P.
+ * Linux, GCC
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/**
+ * @file
+ * @defgroup hal_atomic Atomic blocks <util/atomic.h>
+ *
+ * @brief Same semantics as avr-libc, the I bit in simulated SREG is
+ *        cleared for the block and restored by a cleanup handler.
+ *
+ * @{
+ */
+
+/* Includes ----------------------------------------------------------*/
+#include <avr/interrupt.h>
+
+/* Function definitions ----------------------------------------------*/
+static inline uint8_t hal_atomic_enter(void)
+{
+    uint8_t sreg = SREG;
+    cli();
+    return sreg;
+}
+
+static inline void hal_atomic_restore(const uint8_t *sreg)
+{
+    SREG = *sreg;
+}
+
+static inline void hal_atomic_force_on(const uint8_t *sreg)
+{
+    (void)sreg;
+    sei();
+}
+
+/* Defines -----------------------------------------------------------*/
+#define ATOMIC_RESTORESTATE \
+    uint8_t hal_sreg_save __attribute__((__cleanup__(hal_atomic_restore))) = SREG
+#define ATOMIC_FORCEON \
+    uint8_t hal_sreg_save __attribute__((__cleanup__(hal_atomic_force_on))) = 0
+#define ATOMIC_BLOCK(type) \
+    for (type, hal_atomic_once = hal_atomic_enter() * 0 + 1; \
+         hal_atomic_once; hal_atomic_once = 0)
+
+/** @} */
+
+#endif /* HAL_UTIL_ATOMIC_H */
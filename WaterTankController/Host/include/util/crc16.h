@@ -0,0 +1,52 @@
+#ifndef HAL_UTIL_CRC16_H
+#define HAL_UTIL_CRC16_H
+
+/***********************************************************************
+ *
+ * Host replacement of <util/crc16.h> for the simulated ATmega328P.
+ * Linux, GCC
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/**
+ * @file
+ * @defgroup hal_crc16 CRC computations <util/crc16.h>
+ *
+ * @brief Bitwise C versions of the avr-libc inline assembly, same
+ *        results for the same input.
+ *
+ * @{
+ */
+
+/* Includes ----------------------------------------------------------*/
+#include <stdint.h>
+
+/* Function definitions ----------------------------------------------*/
+/** @brief CRC-16 with polynomial 0xA001, reflected 0x8005 */
+static inline uint16_t _crc16_update(uint16_t crc, uint8_t data)
+{
+    crc ^= data;
+    for (uint8_t i = 0; i < 8; i++)
+        crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+
+    return crc;
+}
+
+/** @brief CRC-8 with polynomial x^8 + x^2 + x + 1 (0x07) */
+static inline uint8_t _crc8_ccitt_update(uint8_t crc, uint8_t data)
+{
+    crc ^= data;
+    for (uint8_t i = 0; i < 8; i++)
+        crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+
+    return crc;
+}
+
+/** @} */
+
+#endif /* HAL_UTIL_CRC16_H */
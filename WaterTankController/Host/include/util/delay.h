@@ -0,0 +1,32 @@
+#ifndef HAL_UTIL_DELAY_H
+#define HAL_UTIL_DELAY_H
+
+/***********************************************************************
+ *
+ * Host replacement of <util/delay.h> for the simulated ATmega328P.
+ * Linux, GCC
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/**
+ * @file
+ * @defgroup hal_delay Busy-wait delays <util/delay.h>
+ *
+ * @brief Delays advance simulated time and let pending interrupts run,
+ *        exactly like a busy loop on the real MCU would.
+ *
+ * @{
+ */
+
+/* Function prototypes -----------------------------------------------*/
+void _delay_us(double us);
+void _delay_ms(double ms);
+
+/** @} */
+
+#endif /* HAL_UTIL_DELAY_H */
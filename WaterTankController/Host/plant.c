@@ -0,0 +1,207 @@
+/***********************************************************************
+ *
+ * Water tank, HC-SR04, pump and valve model for host build.
+ * Linux, GCC
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/* Includes ----------------------------------------------------------*/
+#include "hal.h"
+#include "plant.h"
+
+/* Defines -----------------------------------------------------------*/
+#define TRIG_PIN      PD0
+#define ECHO_PIN      PD2
+#define SERVO_PIN     PB4
+#define RELAY_PIN     PC0
+#define SW_PUMP_PIN   PC1
+#define SW_SERVO_PIN  PC2
+#define VALVE_OPEN_US 1750     // Threshold between closed and open
+#define ECHO_DELAY_US 250      // Burst of 8 periods at 40 kHz and margin
+#define ECHO_RANGE_MM 4500     // Beyond range the echo times out
+#define ECHO_TIMEOUT_US 38000  // Echo length without reflection
+#define ADC_TEMPERATURE 8      // Channel of on-chip temperature sensor
+
+/* Variables ---------------------------------------------------------*/
+static plant_config_t config;
+static plant_state_t state;
+static uint64_t level_updated;
+static uint64_t servo_rise;
+static uint8_t servo_high;
+static uint64_t trig_rise;
+static double stuck_echo_us;
+// Gaps between edges of a flipped switch, odd edge count, 8 ms total.
+// Float switch contact rests for milliseconds in the wrong state
+static const uint16_t bounce_gaps_us[] = {2300, 2100, 300, 1500, 400, 600, 300, 500};
+static uint8_t bounce_edge;
+
+/* Function definitions ----------------------------------------------*/
+/**********************************************************************
+ * Function: update_level()
+ * Purpose:  Integrate water level up to current simulated time.
+ **********************************************************************/
+static void update_level(void)
+{
+    uint64_t now = hal_now();
+    double seconds = (double)(now - level_updated) / HAL_F_CPU;
+
+    if (state.pump_on)
+        state.level_mm += config.inflow_mm_s * seconds;
+    if (state.valve_open)
+        state.level_mm -= config.outflow_mm_s * seconds;
+
+    if (state.level_mm < 0)
+        state.level_mm = 0;
+    if (state.level_mm > config.sensor_height_mm)
+        state.level_mm = config.sensor_height_mm;
+
+    level_updated = now;
+}
+
+/**********************************************************************
+ * Function: flip_valve_switch()
+ * Purpose:  One edge of the bouncing valve switch contact, schedules
+ *           the next one.
+ **********************************************************************/
+static void flip_valve_switch(void *context)
+{
+    (void)context;
+    config.valve_switch = !config.valve_switch;
+    hal_set_input(HAL_PORT_C, SW_SERVO_PIN, config.valve_switch);
+
+    if (bounce_edge < sizeof(bounce_gaps_us) / sizeof(bounce_gaps_us[0]))
+        hal_schedule(hal_now() + HAL_CYCLES_US(bounce_gaps_us[bounce_edge++]),
+                     flip_valve_switch, 0);
+}
+
+static void echo_high(void *context)
+{
+    (void)context;
+    hal_set_input(HAL_PORT_D, ECHO_PIN, 1);
+}
+
+static void echo_low(void *context)
+{
+    (void)context;
+    hal_set_input(HAL_PORT_D, ECHO_PIN, 0);
+}
+
+/**********************************************************************
+ * Function: start_echo()
+ * Purpose:  HC-SR04 answers falling edge of trigger with echo pulse
+ *           as long as the sound travels there and back.
+ **********************************************************************/
+static void start_echo(void)
+{
+    double distance, speed, echo_us;
+    double now_s = (double)hal_now() / HAL_F_CPU;
+    uint64_t rise;
+
+    // Disconnected sensor leaves echo pin high by pull-up
+    if (config.sensor_lost_s >= 0 && now_s >= config.sensor_lost_s) {
+        echo_high(0);
+        return;
+    }
+
+    update_level();
+    distance = config.sensor_height_mm - state.level_mm;
+    // Multipath or splash reflection from half the distance
+    if (config.spike_every && state.pings % config.spike_every == 0)
+        distance /= 2;
+    speed = 331.3 + 0.606 * config.temperature_c;
+
+    if (distance > ECHO_RANGE_MM)
+        echo_us = ECHO_TIMEOUT_US;
+    else
+        echo_us = 2.0 * distance / speed * 1000.0;
+
+    if (config.sensor_stuck_s >= 0 && now_s >= config.sensor_stuck_s) {
+        if (stuck_echo_us == 0)
+            stuck_echo_us = echo_us;
+        echo_us = stuck_echo_us;
+    }
+
+    rise = hal_now() + HAL_CYCLES_US(ECHO_DELAY_US);
+    hal_schedule(rise, echo_high, 0);
+    hal_schedule(rise + (uint64_t)(echo_us * (HAL_F_CPU / 1000000ULL)), echo_low, 0);
+}
+
+/**********************************************************************
+ * Function: on_port()
+ * Purpose:  React to output changes of the controller.
+ **********************************************************************/
+static void on_port(uint8_t port, uint8_t old_level, uint8_t new_level)
+{
+    uint8_t changed = old_level ^ new_level;
+
+    if (port == HAL_PORT_D && (changed & _BV(TRIG_PIN))) {
+        if (new_level & _BV(TRIG_PIN)) {
+            trig_rise = hal_now();
+        }
+        else {
+            // HC-SR04 needs at least 10 us trigger pulse
+            if (hal_now() - trig_rise >= HAL_CYCLES_US(10)) {
+                ++state.pings;
+                start_echo();
+            }
+        }
+    }
+
+    if (port == HAL_PORT_B && (changed & _BV(SERVO_PIN))) {
+        if (new_level & _BV(SERVO_PIN)) {
+            servo_rise = hal_now();
+            servo_high = 1;
+        }
+        else if (servo_high) {
+            servo_high = 0;
+            update_level();
+            state.servo_us = (hal_now() - servo_rise) / (HAL_F_CPU / 1000000ULL);
+            state.valve_open = state.servo_us > VALVE_OPEN_US;
+        }
+    }
+
+    if (port == HAL_PORT_C && (changed & _BV(RELAY_PIN))) {
+        update_level();
+        state.pump_on = (new_level >> RELAY_PIN) & 1;
+        ++state.pump_switches;
+    }
+}
+
+void plant_init(const plant_config_t *plant_config)
+{
+    config = *plant_config;
+
+    state.level_mm = config.level_mm;
+    state.pump_on = 0;
+    state.valve_open = 0;
+    state.servo_us = 0;
+    state.pings = 0;
+    state.pump_switches = 0;
+    level_updated = hal_now();
+    servo_rise = 0;
+    servo_high = 0;
+    trig_rise = 0;
+    stuck_echo_us = 0;
+
+    // Typical on-chip sensor, 324 LSB at 0 degrees and 1.22 LSB/degree
+    hal_set_adc(ADC_TEMPERATURE, (uint16_t)(324.5 + 1.22 * config.temperature_c));
+
+    hal_add_port_hook(on_port);
+    hal_set_input(HAL_PORT_C, SW_PUMP_PIN, config.pump_switch);
+    hal_set_input(HAL_PORT_C, SW_SERVO_PIN, config.valve_switch);
+
+    bounce_edge = 0;
+    if (config.valve_flip_s >= 0)
+        hal_schedule((uint64_t)(config.valve_flip_s * HAL_F_CPU), flip_valve_switch, 0);
+}
+
+void plant_get_state(plant_state_t *out)
+{
+    update_level();
+    *out = state;
+}
@@ -0,0 +1,83 @@
+#ifndef PLANT_H_
+#define PLANT_H_
+
+/***********************************************************************
+ *
+ * Water tank, HC-SR04, pump and valve model for host build.
+ * Linux, GCC
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/**
+ * @file
+ * @defgroup plant Tank model <plant.h>
+ * @code #include "plant.h" @endcode
+ *
+ * @brief Physical process around the controller.
+ *
+ * Wiring follows main.c: TRIG on PD0, ECHO on PD2, servo on PB4, pump
+ * relay on PC0, pump switch on PC1 and valve switch on PC2. Water level
+ * rises while the relay is on and falls while the servo pulse is wider
+ * than the midpoint between closed (1.5 ms) and open (2 ms) position.
+ * Echo length is exact, so still water gives the same echo every ping.
+ * A flipped valve switch bounces with 9 edges over 8 ms.
+ *
+ * @{
+ */
+
+/* Includes ----------------------------------------------------------*/
+#include <stdint.h>
+
+/* Types -------------------------------------------------------------*/
+/** @brief Parameters of the simulated process */
+typedef struct {
+    double sensor_height_mm;  // Sensor above tank bottom
+    double level_mm;          // Initial water level
+    double inflow_mm_s;       // Level rise with pump running
+    double outflow_mm_s;      // Level drop with valve open
+    double temperature_c;     // Air temperature for speed of sound
+    uint8_t pump_switch;      // Manual pump switch
+    uint8_t valve_switch;     // Manual valve switch
+    uint32_t spike_every;     // Spurious short echo every n-th ping, 0 off
+    double sensor_lost_s;     // Sensor stops answering, negative never
+    double sensor_stuck_s;    // Sensor repeats last echo, negative never
+    double valve_flip_s;      // Valve switch flips with bounce, negative never
+} plant_config_t;
+
+/** @brief Observed state of the process */
+typedef struct {
+    double level_mm;          // Current water level
+    uint8_t pump_on;          // Relay output
+    uint8_t valve_open;       // Servo in open position
+    uint16_t servo_us;        // Last servo pulse width
+    uint32_t pings;           // Trigger pulses seen
+    uint32_t pump_switches;   // Relay transitions
+} plant_state_t;
+
+/* Function prototypes -----------------------------------------------*/
+/**
+ * @name Functions
+ */
+
+/**
+ * @brief  Reset the model and register pin hooks.
+ * @param  config Process parameters.
+ * @return none
+ */
+void plant_init(const plant_config_t *config);
+
+/**
+ * @brief  Current state of the process.
+ * @param  state Where to store the state.
+ * @return none
+ */
+void plant_get_state(plant_state_t *state);
+
+/** @} */
+
+#endif /* PLANT_H_ */
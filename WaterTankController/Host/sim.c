@@ -0,0 +1,466 @@
+/***********************************************************************
+ *
+ * Host simulation of the water tank controller.
+ * Linux, GCC
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/* Includes ----------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <math.h>
+#include <avr/interrupt.h>
+#include <util/delay.h>
+#include "config.h"
+#include "debounce.h"
+#include "geometry.h"
+#include "hal.h"
+#include "hd44780.h"
+#include "latency.h"
+#include "lcd.h"
+#include "plant.h"
+#include "timer.h"
+
+/* Variables ---------------------------------------------------------*/
+// Firmware entry point, main() of main.c renamed by the build
+extern int firmware_main(void);
+// Filtered distance in cm, maintained by the firmware
+extern uint16_t distance;
+
+// Result of geometry_exercise()
+static uint8_t geometry_failures;
+// Stable level changes seen by debounce_exercise() and the first one
+static uint8_t debounce_changes;
+static uint64_t debounce_accepted;
+
+static uint64_t log_period;
+static uint8_t quiet;
+static FILE *uart_file;
+static unsigned long uart_bytes;
+
+/* Function definitions ----------------------------------------------*/
+/**********************************************************************
+ * Function: log_state()
+ * Purpose:  Print process state and LCD content, reschedule itself.
+ **********************************************************************/
+static void log_state(void *context)
+{
+    char line0[HD44780_COLS + 1];
+    char line1[HD44780_COLS + 1];
+    plant_state_t state;
+
+    (void)context;
+    plant_get_state(&state);
+    hd44780_line(0, line0);
+    hd44780_line(1, line1);
+
+    printf("%9.3f s  level %7.1f mm  pump %-3s  valve %-3s  |%s|%s|\n",
+           (double)hal_now() / HAL_F_CPU, state.level_mm,
+           state.pump_on ? "on" : "off", state.valve_open ? "opn" : "cls",
+           line0, line1);
+
+    hal_schedule(hal_now() + log_period, log_state, 0);
+}
+
+/**********************************************************************
+ * Function: uart_byte()
+ * Purpose:  Count bytes sent by USART0 and capture them to a file.
+ **********************************************************************/
+static void uart_byte(uint8_t data)
+{
+    ++uart_bytes;
+    if (uart_file)
+        fputc(data, uart_file);
+}
+
+/**********************************************************************
+ * Function: lcd_exercise()
+ * Purpose:  Drive the asynchronous LCD driver alone: overfill the
+ *           transmit queue, clear display through the queue and wait
+ *           for the last byte with lcd_flush().
+ **********************************************************************/
+static int lcd_exercise(void)
+{
+    // Transmit interrupt counts TIM1 ticks of 0.5 us like in firmware
+    lcd_init(LCD_DISP_ON);
+    TIM1_overflow_33ms();
+    sei();
+
+    for (uint8_t i = 0; i < 5; i++)
+        lcd_puts("0123456789ABCDEF");
+    lcd_clrscr();
+    lcd_puts("cleared");
+    lcd_flush();
+
+    return 0;
+}
+
+/**********************************************************************
+ * Function: lcd_check()
+ * Purpose:  Run lcd_exercise() and compare what the model shows.
+ * Returns:  0 on success, 1 on failure
+ **********************************************************************/
+static int lcd_check(void)
+{
+    char line0[HD44780_COLS + 1];
+    char line1[HD44780_COLS + 1];
+    uint8_t ok;
+
+    hal_init(HAL_CYCLES_MS(1000));
+    hd44780_init();
+    hal_run(lcd_exercise);
+
+    hd44780_line(0, line0);
+    hd44780_line(1, line1);
+    ok = !strcmp(line0, "cleared         ") && !strcmp(line1, "                ") &&
+         hd44780_busy_writes() == 0 && lcd_idle();
+
+    printf("LCD driver %s after %.3f ms: |%s|%s|, %u bytes, %u while busy\n",
+           ok ? "ok" : "FAILED", (double)hal_now() * 1000 / HAL_F_CPU,
+           line0, line1, (unsigned)hd44780_bytes(),
+           (unsigned)hd44780_busy_writes());
+
+    return !ok;
+}
+
+/**********************************************************************
+ * Function: geometry_tank()
+ * Purpose:  Store tank of the largest accepted dimensions and compare
+ *           its table with the exact volume.
+ * Input:    shape - Tank shape
+ *           exact - Volume of full tank in litres
+ **********************************************************************/
+static void geometry_tank(geometry_shape_t shape, double exact)
+{
+    static const char *names[] = { "vertical", "horizontal", "conical" };
+    uint16_t d = GEOMETRY_MAX_DIAMETER_CM;
+    uint16_t l = GEOMETRY_MAX_LENGTH_CM;
+    uint16_t c = GEOMETRY_MAX_CM;
+    const config_t *config = config_get();
+    geometry_t tank;
+    uint8_t ok = 1;
+
+    // One centimetre more is out of range
+    if (config_set_shape(shape, d + 1, l, c) ||
+        config_set_shape(shape, d, l + 1, c) ||
+        config_set_shape(shape, d, l, c + 1))
+        ok = 0;
+    if (!config_set_shape(shape, d, l, c))
+        ok = 0;
+
+    tank.shape = config->shape;
+    tank.sensor_cm = config->total_height;
+    tank.height_cm = config->water_height;
+    tank.diameter_cm = config->diameter_cm;
+    tank.length_cm = config->length_cm;
+    tank.cone_cm = config->cone_cm;
+    geometry_init(&tank);
+
+    // Volume never grows with distance
+    for (uint16_t i = 1; i <= GEOMETRY_MAX_CM; i++) {
+        if (geometry_litres(i) > geometry_litres(i - 1))
+            ok = 0;
+    }
+    if (fabs(geometry_capacity() - exact) > exact / 100)
+        ok = 0;
+
+    printf("%-10s tank d %u cm, l %u cm, cone %u cm: %u litres (exact %.0f) %s\n",
+           names[shape], d, l, c, (unsigned)geometry_capacity(), exact,
+           ok ? "ok" : "FAILED");
+    geometry_failures += !ok;
+}
+
+/**********************************************************************
+ * Function: geometry_calibration()
+ * Purpose:  Select a non-linear calibration table and compare volume
+ *           at every table node with the exact interpolation.
+ * Input:    h - Water height, sensor is 2 cm above it
+ **********************************************************************/
+static void geometry_calibration(uint16_t h)
+{
+    // Narrow bottom, wide middle and narrow neck, knots on table nodes
+    static const geometry_point_t points[] PROGMEM = {
+        {  0,    0}, { 96,  500}, {200, 3000}, {304, 4000},
+        {400, 9000}, {510, 9500},
+    };
+    const uint8_t count = sizeof(points) / sizeof(points[0]);
+    const config_t *config = config_get();
+    geometry_t tank;
+    uint8_t ok = 1;
+    double worst = 0;
+
+    // Shape is refused until the application attaches a table
+    if (config_set_shape(GEOMETRY_CALIBRATION, 0, 0, 0))
+        ok = 0;
+    config_attach_table(points, count);
+    if (!config_set_shape(GEOMETRY_CALIBRATION, 0, 0, 0))
+        ok = 0;
+
+    tank.shape = config->shape;
+    tank.sensor_cm = config->total_height;
+    tank.height_cm = config->water_height;
+    tank.table = config_get_table(&tank.points);
+    geometry_init(&tank);
+
+    for (uint16_t d = GEOMETRY_STEP; d < GEOMETRY_MAX_CM; d += GEOMETRY_STEP) {
+        double level = tank.sensor_cm - d;
+        double exact = 0;
+
+        for (uint8_t i = 1; i < count; i++) {
+            if (level <= points[i].level_cm) {
+                exact = points[i - 1].litres +
+                        (double)(points[i].litres - points[i - 1].litres) *
+                        (level - points[i - 1].level_cm) /
+                        (points[i].level_cm - points[i - 1].level_cm);
+                break;
+            }
+        }
+        if (fabs(geometry_litres(d) - exact) > worst)
+            worst = fabs(geometry_litres(d) - exact);
+    }
+    if (worst > 1 || geometry_capacity() != points[count - 1].litres)
+        ok = 0;
+
+    printf("%-10s tank of %u points: %u litres, worst error %.2f litres %s\n",
+           "calibrated", count, (unsigned)geometry_capacity(), worst,
+           ok ? "ok" : "FAILED");
+    geometry_failures += !ok;
+}
+
+/**********************************************************************
+ * Function: geometry_exercise()
+ * Purpose:  Check volume tables of the largest tanks the configuration
+ *           accepts and of a calibrated one, water fills all the table.
+ **********************************************************************/
+static int geometry_exercise(void)
+{
+    uint16_t h = GEOMETRY_MAX_CM - 2;
+    double r = GEOMETRY_MAX_DIAMETER_CM / 2.0;
+    double area = M_PI * r * r / 1000;
+
+    config_load();
+    if (!config_set_heights(h, 2) || config_set_heights(h, 3))
+        ++geometry_failures;
+
+    geometry_tank(GEOMETRY_VERTICAL_CYLINDER, area * h);
+    geometry_tank(GEOMETRY_HORIZONTAL_CYLINDER, area * GEOMETRY_MAX_LENGTH_CM);
+    // Cone is higher than water, level h fills a cone of radius r*h/c
+    geometry_tank(GEOMETRY_CONICAL_BOTTOM,
+                  area * h * h * h / (3.0 * GEOMETRY_MAX_CM * GEOMETRY_MAX_CM));
+
+    geometry_calibration(h);
+    return 0;
+}
+
+/**********************************************************************
+ * Function: debounce_exercise()
+ * Purpose:  Sample the valve switch every millisecond like the firmware
+ *           does, count changes of its stable level.
+ **********************************************************************/
+static int debounce_exercise(void)
+{
+    debounce_init(&PINC, _BV(PC2));
+
+    for (;;) {
+        _delay_ms(1);
+        if (debounce_sample()) {
+            if (!debounce_changes++)
+                debounce_accepted = hal_now();
+        }
+    }
+
+    return 0;
+}
+
+/**********************************************************************
+ * Function: debounce_check()
+ * Purpose:  Flip the bouncing valve switch of the plant once and check
+ *           that the debouncer accepts it exactly once, no later than
+ *           DEBOUNCE_SAMPLES ms after the last edge.
+ * Returns:  0 on success, 1 on failure
+ **********************************************************************/
+static int debounce_check(plant_config_t *config)
+{
+    uint64_t flip = HAL_CYCLES_MS(10);
+    // Plant bounces for 8 ms, one more sample for the phase
+    uint64_t limit = flip + HAL_CYCLES_MS(8 + DEBOUNCE_SAMPLES + 1);
+    uint8_t ok;
+
+    config->valve_flip_s = (double)flip / HAL_F_CPU;
+    hal_init(HAL_CYCLES_MS(100));
+    plant_init(config);
+    hal_run(debounce_exercise);
+
+    ok = debounce_changes == 1 && (debounce_get_state() & _BV(PC2)) &&
+         debounce_accepted <= limit;
+    printf("switch debounce %s: level changed %u times, first after %.3f ms of 8 ms bounce\n",
+           ok ? "ok" : "FAILED", (unsigned)debounce_changes,
+           (double)(debounce_accepted - flip) * 1000 / HAL_F_CPU);
+
+    return !ok;
+}
+
+static double wall_seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**********************************************************************
+ * Function: eeprom_file()
+ * Purpose:  Load or save EEPROM image, a missing file reads as blank.
+ **********************************************************************/
+static void eeprom_file(const char *path, uint8_t save)
+{
+    FILE *f = fopen(path, save ? "wb" : "rb");
+
+    if (!f) {
+        if (save)
+            perror(path);
+        return;
+    }
+    if (save)
+        fwrite(hal_eeprom(), 1, HAL_EEPROM_SIZE, f);
+    else if (fread(hal_eeprom(), 1, HAL_EEPROM_SIZE, f) != HAL_EEPROM_SIZE)
+        fprintf(stderr, "%s: short EEPROM image\n", path);
+    fclose(f);
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -t SEC   simulated time (default 60)\n"
+            "  -l MM    initial water level (default 2000)\n"
+            "  -H MM    sensor height above bottom (default 4200)\n"
+            "  -i MM/S  level rise with pump on (default 50)\n"
+            "  -o MM/S  level drop with valve open (default 80)\n"
+            "  -T DEGC  air temperature (default 20)\n"
+            "  -p 0|1   pump switch (default 1)\n"
+            "  -v 0|1   valve switch (default 0)\n"
+            "  -x N     spurious short echo every N-th ping (default off)\n"
+            "  -d SEC   sensor disconnected from SEC (default never)\n"
+            "  -s SEC   sensor repeats its echo from SEC (default never)\n"
+            "  -w SEC   valve switch flips with contact bounce at SEC (default never)\n"
+            "  -r SEC   log period (default 1)\n"
+            "  -u FILE  capture telemetry stream, - for stdout\n"
+            "  -e FILE  EEPROM image, loaded at start and saved at end\n"
+            "  -q       print summary only\n"
+            "  -L       check asynchronous LCD driver alone and exit\n"
+            "  -G       check volume of the largest and a calibrated tank and exit\n"
+            "  -B       check debouncer with the bouncing valve switch and exit\n",
+            name);
+}
+
+/**********************************************************************
+ * Function: main()
+ * Purpose:  Parse options, wire models to the simulated MCU and run
+ *           the firmware.
+ **********************************************************************/
+int main(int argc, char *argv[])
+{
+    plant_config_t config = {
+        .sensor_height_mm = 4200,
+        .level_mm = 2000,
+        .inflow_mm_s = 50,
+        .outflow_mm_s = 80,
+        .temperature_c = 20,
+        .pump_switch = 1,
+        .valve_switch = 0,
+        .spike_every = 0,
+        .sensor_lost_s = -1,
+        .sensor_stuck_s = -1,
+        .valve_flip_s = -1,
+    };
+    const char *eeprom_path = NULL;
+    double seconds = 60, period = 1, wall;
+    plant_state_t state;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:l:H:i:o:T:p:v:x:d:s:w:r:u:e:qLGBh")) != -1) {
+        switch (opt) {
+        case 't': seconds = atof(optarg); break;
+        case 'l': config.level_mm = atof(optarg); break;
+        case 'H': config.sensor_height_mm = atof(optarg); break;
+        case 'i': config.inflow_mm_s = atof(optarg); break;
+        case 'o': config.outflow_mm_s = atof(optarg); break;
+        case 'T': config.temperature_c = atof(optarg); break;
+        case 'p': config.pump_switch = atoi(optarg) != 0; break;
+        case 'v': config.valve_switch = atoi(optarg) != 0; break;
+        case 'x': config.spike_every = atoi(optarg); break;
+        case 'd': config.sensor_lost_s = atof(optarg); break;
+        case 's': config.sensor_stuck_s = atof(optarg); break;
+        case 'w': config.valve_flip_s = atof(optarg); break;
+        case 'r': period = atof(optarg); break;
+        case 'u':
+            uart_file = strcmp(optarg, "-") ? fopen(optarg, "wb") : stdout;
+            if (!uart_file) {
+                perror(optarg);
+                return 1;
+            }
+            break;
+        case 'e': eeprom_path = optarg; break;
+        case 'q': quiet = 1; break;
+        case 'L': return lcd_check();
+        case 'B': return debounce_check(&config);
+        case 'G':
+            // EEPROM writes take 3.4 ms per byte
+            hal_init(HAL_CYCLES_MS(10000));
+            hal_run(geometry_exercise);
+            return geometry_failures != 0;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (seconds <= 0 || period <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    hal_init((uint64_t)(seconds * HAL_F_CPU));
+    if (eeprom_path)
+        eeprom_file(eeprom_path, 0);
+    hd44780_init();
+    plant_init(&config);
+    hal_add_uart_hook(uart_byte);
+
+    log_period = (uint64_t)(period * HAL_F_CPU);
+    if (!quiet)
+        hal_schedule(log_period, log_state, 0);
+
+    wall = wall_seconds();
+    hal_run(firmware_main);
+    wall = wall_seconds() - wall;
+
+    plant_get_state(&state);
+    printf("simulated %.3f s in %.3f s (%.0fx real time)\n",
+           seconds, wall, wall > 0 ? seconds / wall : 0.0);
+    printf("distance %u cm (true %.1f cm)\n", (unsigned)distance,
+           (config.sensor_height_mm - state.level_mm) / 10);
+    printf("level %.1f mm, %u pings, %u pump switches, %llu ISRs, "
+           "%u LCD bytes, worst ISR latency %u ticks\n",
+           state.level_mm, (unsigned)state.pings, (unsigned)state.pump_switches,
+           (unsigned long long)hal_isr_count(), (unsigned)hd44780_bytes(),
+           (unsigned)latency_get_max());
+    printf("%lu telemetry bytes, %u LCD bytes while busy\n", uart_bytes,
+           (unsigned)hd44780_busy_writes());
+
+    if (eeprom_path)
+        eeprom_file(eeprom_path, 1);
+    if (uart_file && uart_file != stdout)
+        fclose(uart_file);
+
+    return 0;
+}
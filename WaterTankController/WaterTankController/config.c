@@ -0,0 +1,223 @@
+/***********************************************************************
+ *
+ * Persistent configuration in EEPROM for AVR-GCC.
+ * ATmega328P (Arduino Uno), 16 MHz, AVR 8-bit Toolchain 3.6.2
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/* Includes ----------------------------------------------------------*/
+#include <avr/eeprom.h>     // EEPROM handling
+#include <util/crc16.h>     // CRC computations
+#include "config.h"
+#include "eventlog.h"
+
+/* Defines -----------------------------------------------------------*/
+#define CONFIG_EEPROM ((config_t *)CONFIG_EEPROM_ADDR)
+
+#if CONFIG_DIAMETER > GEOMETRY_MAX_DIAMETER_CM || CONFIG_LENGTH > GEOMETRY_MAX_LENGTH_CM || CONFIG_CONE > GEOMETRY_MAX_CM
+#error "Default tank is too large for the volume table"
+#endif
+
+/* Variables ---------------------------------------------------------*/
+// Working copy of the EEPROM block
+static config_t config;
+// Calibration table supplied by the application, kept in PROGMEM
+static const geometry_point_t *table;
+static uint8_t table_points;
+
+/* Function definitions ----------------------------------------------*/
+/**********************************************************************
+ * Function: config_crc()
+ * Purpose:  CRC-16 of configuration fields without the CRC itself.
+ * Input:    block - Configuration block
+ * Returns:  CRC-16
+ **********************************************************************/
+static uint16_t config_crc(const config_t *block)
+{
+    const uint8_t *p = (const uint8_t *)block;
+    uint16_t crc = 0xFFFF;
+
+    for (uint8_t i = 0; i < sizeof(config_t) - sizeof(block->crc); i++)
+        crc = _crc16_update(crc, p[i]);
+
+    return crc;
+}
+
+/**********************************************************************
+ * Function: config_store()
+ * Purpose:  Recompute derived values and CRC, write changed bytes.
+ * Input:    none
+ * Returns:  none
+ **********************************************************************/
+static void config_store()
+{
+    config.version = CONFIG_VERSION;
+    // Valve opens halfway between sensor and max water level
+    config.max_level = config.air_gap / 2;
+    config.total_height = config.water_height + config.air_gap;
+    config.pump_start = config.air_gap + config.pump_band;
+    config.crc = config_crc(&config);
+
+    // Event log interrupt must not move EEPROM address during the write
+    eventlog_sync();
+    eeprom_update_block(&config, CONFIG_EEPROM, sizeof(config));
+}
+
+/**********************************************************************
+ * Function: config_load()
+ * Purpose:  Read configuration block, store defaults if it is blank,
+ *           corrupted or of another layout version.
+ * Input:    none
+ * Returns:  1 if block was valid, 0 if defaults were stored
+ **********************************************************************/
+uint8_t config_load()
+{
+    eeprom_read_block(&config, CONFIG_EEPROM, sizeof(config));
+
+    // Calibration shape is valid only with a table in this firmware
+    if (config.version == CONFIG_VERSION && config.crc == config_crc(&config) &&
+        (config.shape != GEOMETRY_CALIBRATION || table_points >= 2))
+        return 1;
+
+    config.shape = CONFIG_SHAPE;
+    config.water_height = CONFIG_WATER_HEIGHT;
+    config.air_gap = CONFIG_AIR_GAP;
+    config.diameter_cm = CONFIG_DIAMETER;
+    config.length_cm = CONFIG_LENGTH;
+    config.cone_cm = CONFIG_CONE;
+    config.pump_band = CONFIG_PUMP_BAND;
+    config.pump_min_on = CONFIG_PUMP_MIN_ON;
+    config.pump_min_off = CONFIG_PUMP_MIN_OFF;
+    config.pump_min_cycle = CONFIG_PUMP_MIN_CYCLE;
+    config_store();
+
+    return 0;
+}
+
+/**********************************************************************
+ * Function: config_attach_table()
+ * Purpose:  Make calibration table known, call before config_load().
+ * Input:    points - Calibration table in program memory
+ *           count  - Number of points, at least 2 to be usable
+ * Returns:  none
+ **********************************************************************/
+void config_attach_table(const geometry_point_t *points, uint8_t count)
+{
+    table = points;
+    table_points = count;
+}
+
+/**********************************************************************
+ * Function: config_get_table()
+ * Purpose:  Calibration table of GEOMETRY_CALIBRATION shape.
+ * Input:    count - Where to store number of points
+ * Returns:  Table in program memory, NULL if none is attached
+ **********************************************************************/
+const geometry_point_t *config_get_table(uint8_t *count)
+{
+    *count = table_points;
+
+    return table;
+}
+
+/**********************************************************************
+ * Function: config_get()
+ * Purpose:  Current configuration.
+ * Input:    none
+ * Returns:  Pointer to configuration
+ **********************************************************************/
+const config_t *config_get()
+{
+    return &config;
+}
+
+/**********************************************************************
+ * Function: config_set_heights()
+ * Purpose:  Change water height and air gap and store them.
+ * Input:    water_height - Max water height in cm
+ *           air_gap      - Gap between sensor and max water height
+ * Returns:  1 if stored, 0 if values are out of range
+ **********************************************************************/
+uint8_t config_set_heights(uint16_t water_height, uint16_t air_gap)
+{
+    // Valve threshold needs at least 1 cm, sensor must fit the table
+    // and pump start level must stay inside the tank
+    if (!water_height || air_gap < 2 ||
+        (uint32_t)water_height + air_gap > GEOMETRY_MAX_CM ||
+        config.pump_band >= water_height)
+        return 0;
+
+    config.water_height = water_height;
+    config.air_gap = air_gap;
+    config_store();
+
+    return 1;
+}
+
+/**********************************************************************
+ * Function: config_set_shape()
+ * Purpose:  Change tank shape and store it.
+ * Input:    shape       - Tank shape
+ *           diameter_cm - Cylinder diameter
+ *           length_cm   - Length of horizontal cylinder
+ *           cone_cm     - Height of conical bottom
+ * Returns:  1 if stored, 0 if values are out of range
+ **********************************************************************/
+uint8_t config_set_shape(geometry_shape_t shape, uint16_t diameter_cm,
+                         uint16_t length_cm, uint16_t cone_cm)
+{
+    // Calibration table lives in program memory, EEPROM only selects it
+    if (shape == GEOMETRY_CALIBRATION) {
+        if (table_points < 2)
+            return 0;
+    }
+    else if (shape > GEOMETRY_CALIBRATION || !diameter_cm) {
+        return 0;
+    }
+    // Volume of the largest tank must fit the 16-bit table
+    if (diameter_cm > GEOMETRY_MAX_DIAMETER_CM ||
+        length_cm > GEOMETRY_MAX_LENGTH_CM || cone_cm > GEOMETRY_MAX_CM)
+        return 0;
+    if (shape == GEOMETRY_HORIZONTAL_CYLINDER && !length_cm)
+        return 0;
+    if (shape == GEOMETRY_CONICAL_BOTTOM && !cone_cm)
+        return 0;
+
+    config.shape = shape;
+    config.diameter_cm = diameter_cm;
+    config.length_cm = length_cm;
+    config.cone_cm = cone_cm;
+    config_store();
+
+    return 1;
+}
+
+/**********************************************************************
+ * Function: config_set_pump()
+ * Purpose:  Change pump hysteresis and timing and store them.
+ * Input:    band      - Pump starts this far below full level in cm
+ *           min_on    - Minimum run time in s
+ *           min_off   - Minimum rest time in s
+ *           min_cycle - Minimum time between two starts in s
+ * Returns:  1 if stored, 0 if values are out of range
+ **********************************************************************/
+uint8_t config_set_pump(uint16_t band, uint16_t min_on, uint16_t min_off,
+                        uint16_t min_cycle)
+{
+    // Start level must stay inside the tank
+    if (!band || band >= config.water_height)
+        return 0;
+
+    config.pump_band = band;
+    config.pump_min_on = min_on;
+    config.pump_min_off = min_off;
+    config.pump_min_cycle = min_cycle;
+    config_store();
+
+    return 1;
+}
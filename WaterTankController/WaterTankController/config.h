@@ -0,0 +1,168 @@
+#ifndef CONFIG_H_
+#define CONFIG_H_
+
+/***********************************************************************
+ *
+ * Persistent configuration in EEPROM for AVR-GCC.
+ * ATmega328P (Arduino Uno), 16 MHz, AVR 8-bit Toolchain 3.6.2
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/**
+ * @file
+ * @defgroup config Persistent configuration <config.h>
+ * @code #include "config.h" @endcode
+ *
+ * @brief Tank geometry and thresholds kept in EEPROM across resets.
+ *
+ * The block carries a layout version and a CRC-16 of its content. A
+ * blank, corrupted or older block is replaced by compiled-in defaults
+ * on load. Thresholds derived from the heights are stored with the
+ * block, so boot only reads and checks it. Setters validate the new
+ * values and write only the bytes which differ from EEPROM content,
+ * each written byte blocks for about 3.4 ms. Records queued by the
+ * event log are written first, so setters need interrupts enabled.
+ * A calibration table of an irregular tank does not fit the block, the
+ * application attaches it from program memory and the block only
+ * selects GEOMETRY_CALIBRATION.
+ *
+ * @{
+ */
+
+/* Includes ----------------------------------------------------------*/
+#include <avr/io.h>         // AVR device-specific IO definitions
+#include "geometry.h"       // Tank geometry lookup table
+
+/* Defines -----------------------------------------------------------*/
+#define CONFIG_VERSION      2       // Changes with layout of config_t
+#define CONFIG_EEPROM_ADDR  0x000   // Start of the block in EEPROM
+
+// Defaults of a blank EEPROM
+#ifndef CONFIG_WATER_HEIGHT
+#define CONFIG_WATER_HEIGHT 400     // Max water height in cm
+#endif
+#ifndef CONFIG_AIR_GAP
+#define CONFIG_AIR_GAP      20      // Sensor above max water height in cm
+#endif
+#ifndef CONFIG_SHAPE
+#define CONFIG_SHAPE        GEOMETRY_VERTICAL_CYLINDER
+#endif
+#ifndef CONFIG_DIAMETER
+#define CONFIG_DIAMETER     100     // Cylinder diameter in cm
+#endif
+#ifndef CONFIG_LENGTH
+#define CONFIG_LENGTH       0       // Horizontal cylinder length in cm
+#endif
+#ifndef CONFIG_CONE
+#define CONFIG_CONE         0       // Conical bottom height in cm
+#endif
+#ifndef CONFIG_PUMP_BAND
+#define CONFIG_PUMP_BAND    10      // Pump hysteresis below air gap in cm
+#endif
+#ifndef CONFIG_PUMP_MIN_ON
+#define CONFIG_PUMP_MIN_ON  20      // Minimum pump run time in s
+#endif
+#ifndef CONFIG_PUMP_MIN_OFF
+#define CONFIG_PUMP_MIN_OFF 20      // Minimum pump rest time in s
+#endif
+#ifndef CONFIG_PUMP_MIN_CYCLE
+#define CONFIG_PUMP_MIN_CYCLE 120   // Minimum time between starts in s
+#endif
+
+/* Types -------------------------------------------------------------*/
+/** @brief Configuration block as stored in EEPROM */
+typedef struct {
+    uint8_t version;         // CONFIG_VERSION
+    uint8_t shape;           // geometry_shape_t
+    uint16_t water_height;   // Max water height in cm
+    uint16_t air_gap;        // Gap between sensor and max water height
+    uint16_t diameter_cm;    // Cylinder diameter
+    uint16_t length_cm;      // Length of horizontal cylinder
+    uint16_t cone_cm;        // Height of conical bottom
+    uint16_t pump_band;      // Pump starts this far below full level
+    uint16_t pump_min_on;    // Minimum pump run time in s
+    uint16_t pump_min_off;   // Minimum pump rest time in s
+    uint16_t pump_min_cycle; // Minimum time between pump starts in s
+    uint16_t total_height;   // Derived, sensor above tank bottom
+    uint16_t max_level;      // Derived, distance which opens valve
+    uint16_t pump_start;     // Derived, distance which starts pump
+    uint16_t crc;            // CRC-16 of all fields above
+} config_t;
+
+/* Function prototypes -----------------------------------------------*/
+/**
+ * @name Functions
+ */
+
+/**
+ * @brief  Read configuration block, store defaults if it is invalid.
+ * @param  none
+ * @return 1 if block was valid, 0 if defaults were stored
+ */
+uint8_t config_load();
+
+/**
+ * @brief  Make calibration table of GEOMETRY_CALIBRATION shape known,
+ *         call before config_load().
+ * @param  points Calibration table in program memory
+ * @param  count  Number of points, at least 2 to be usable
+ * @return none
+ */
+void config_attach_table(const geometry_point_t *points, uint8_t count);
+
+/**
+ * @brief  Calibration table attached by the application.
+ * @param  count Where to store number of points
+ * @return Table in program memory, NULL if none is attached
+ */
+const geometry_point_t *config_get_table(uint8_t *count);
+
+/**
+ * @brief  Current configuration.
+ * @param  none
+ * @return Pointer to configuration, valid until the next setter call
+ */
+const config_t *config_get();
+
+/**
+ * @brief  Change water height and air gap and store them.
+ * @param  water_height Max water height in cm
+ * @param  air_gap      Gap between sensor and max water height in cm
+ * @return 1 if stored, 0 if values are out of range
+ */
+uint8_t config_set_heights(uint16_t water_height, uint16_t air_gap);
+
+/**
+ * @brief  Change tank shape and store it.
+ * @param  shape       Tank shape, GEOMETRY_CALIBRATION only with an
+ *                     attached table, not GEOMETRY_CALIBRATION
+ * @param  diameter_cm Cylinder diameter in cm, GEOMETRY_MAX_DIAMETER_CM
+ *                     at most
+ * @param  length_cm   Length of horizontal cylinder in cm,
+ *                     GEOMETRY_MAX_LENGTH_CM at most
+ * @param  cone_cm     Height of conical bottom in cm, GEOMETRY_MAX_CM
+ *                     at most
+ * @return 1 if stored, 0 if values are out of range
+ */
+uint8_t config_set_shape(geometry_shape_t shape, uint16_t diameter_cm,
+                         uint16_t length_cm, uint16_t cone_cm);
+
+/**
+ * @brief  Change pump hysteresis and timing and store them.
+ * @param  band      Pump starts this far below full level in cm
+ * @param  min_on    Minimum run time in s
+ * @param  min_off   Minimum rest time in s
+ * @param  min_cycle Minimum time between two starts in s
+ * @return 1 if stored, 0 if values are out of range
+ */
+uint8_t config_set_pump(uint16_t band, uint16_t min_on, uint16_t min_off,
+                        uint16_t min_cycle);
+
+/** @} */
+
+#endif /* CONFIG_H_ */
@@ -0,0 +1,111 @@
+/***********************************************************************
+ *
+ * Integrating debouncer of switch inputs for AVR-GCC.
+ * ATmega328P (Arduino Uno), 16 MHz, AVR 8-bit Toolchain 3.6.2
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/* Includes ----------------------------------------------------------*/
+#include "debounce.h"
+
+/* Variables ---------------------------------------------------------*/
+// Pin Register of the switches and their pins
+static volatile uint8_t *switch_pins;
+static uint8_t switch_mask;
+// Stable level, written by sampling interrupt
+static volatile uint8_t state;
+// Integrator of every pin in the interval 0 to DEBOUNCE_SAMPLES
+static uint8_t integrator[8];
+// All integrators rest at their stable level
+static volatile uint8_t settled;
+
+/* Function definitions ----------------------------------------------*/
+/**********************************************************************
+ * Function: debounce_init()
+ * Purpose:  Take current level of pins as stable.
+ * Input:    pin_reg - Address of Pin Register, such as &PINC
+ *           mask    - Switch pins of the port
+ * Returns:  none
+ **********************************************************************/
+void debounce_init(volatile uint8_t *pin_reg, uint8_t mask)
+{
+    switch_pins = pin_reg;
+    switch_mask = mask;
+    state = *pin_reg & mask;
+    settled = 1;
+
+    for (uint8_t i = 0; i < 8; i++)
+        integrator[i] = (state & (1<<i)) ? DEBOUNCE_SAMPLES : 0;
+}
+
+/**********************************************************************
+ * Function: debounce_sample()
+ * Purpose:  Move integrator of every switch pin one step towards its
+ *           level, accept the level when a limit is reached.
+ * Input:    none
+ * Returns:  Bit mask of pins whose stable level has just changed
+ **********************************************************************/
+uint8_t debounce_sample()
+{
+    uint8_t level = *switch_pins;
+    uint8_t stable = state;
+    uint8_t changed;
+    uint8_t resting = 1;
+
+    for (uint8_t i = 0; i < 8; i++) {
+        uint8_t bit = (1<<i);
+
+        if (!(switch_mask & bit))
+            continue;
+
+        if (level & bit) {
+            if (integrator[i] < DEBOUNCE_SAMPLES)
+                ++integrator[i];
+            if (integrator[i] == DEBOUNCE_SAMPLES)
+                stable |= bit;
+        }
+        else {
+            if (integrator[i] > 0)
+                --integrator[i];
+            if (integrator[i] == 0)
+                stable &= ~bit;
+        }
+
+        // Integrator between limits still waits for the level to settle
+        if (integrator[i] != 0 && integrator[i] != DEBOUNCE_SAMPLES)
+            resting = 0;
+    }
+
+    settled = resting;
+    changed = stable ^ state;
+    state = stable;
+
+    return changed;
+}
+
+/**********************************************************************
+ * Function: debounce_is_settled()
+ * Purpose:  Check whether sampling may stop until the next pin change.
+ * Input:    none
+ * Returns:  1 if all integrators rest at their stable level, 0 otherwise
+ **********************************************************************/
+uint8_t debounce_is_settled()
+{
+    return settled;
+}
+
+/**********************************************************************
+ * Function: debounce_get_state()
+ * Purpose:  Stable level of switch pins.
+ * Input:    none
+ * Returns:  Pin Register bits, only pins in the mask are valid
+ **********************************************************************/
+uint8_t debounce_get_state()
+{
+    return state;
+}
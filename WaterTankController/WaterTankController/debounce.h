@@ -0,0 +1,78 @@
+#ifndef DEBOUNCE_H_
+#define DEBOUNCE_H_
+
+/***********************************************************************
+ *
+ * Integrating debouncer of switch inputs for AVR-GCC.
+ * ATmega328P (Arduino Uno), 16 MHz, AVR 8-bit Toolchain 3.6.2
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/**
+ * @file
+ * @defgroup debounce Switch debouncer <debounce.h>
+ * @code #include "debounce.h" @endcode
+ *
+ * @brief Stable level of switch pins on one port.
+ *
+ * Every pin has an integrator which counts up on each sample read high
+ * and down on each sample read low, limited to 0..DEBOUNCE_SAMPLES.
+ * The stable level changes only when the integrator reaches a limit,
+ * so contact bounce shorter than DEBOUNCE_SAMPLES samples is ignored
+ * and a clean edge is accepted after DEBOUNCE_SAMPLES samples.
+ *
+ * Sampling is needed only after a pin change interrupt until all
+ * integrators rest at the limit of their stable level, which
+ * debounce_is_settled() tells.
+ *
+ * @{
+ */
+
+/* Includes ----------------------------------------------------------*/
+#include <avr/io.h>         // AVR device-specific IO definitions
+
+/* Defines -----------------------------------------------------------*/
+#define DEBOUNCE_SAMPLES 10 // Samples of a new level before it is accepted
+
+/* Function prototypes -----------------------------------------------*/
+/**
+ * @name Functions
+ */
+
+/**
+ * @brief  Take current level of pins as stable.
+ * @param  pin_reg Address of Pin Register, such as &PINC
+ * @param  mask    Switch pins of the port
+ * @return none
+ */
+void debounce_init(volatile uint8_t *pin_reg, uint8_t mask);
+
+/**
+ * @brief  Read pins once and update integrators, call periodically.
+ * @param  none
+ * @return Bit mask of pins whose stable level has just changed
+ */
+uint8_t debounce_sample();
+
+/**
+ * @brief  Check whether sampling may stop until the next pin change.
+ * @param  none
+ * @return 1 if all integrators rest at their stable level, 0 otherwise
+ */
+uint8_t debounce_is_settled();
+
+/**
+ * @brief  Stable level of switch pins.
+ * @param  none
+ * @return Pin Register bits, only pins in the mask are valid
+ */
+uint8_t debounce_get_state();
+
+/** @} */
+
+#endif /* DEBOUNCE_H_ */
@@ -0,0 +1,252 @@
+/***********************************************************************
+ *
+ * EEPROM ring log of pump, valve and level events for AVR-GCC.
+ * ATmega328P (Arduino Uno), 16 MHz, AVR 8-bit Toolchain 3.6.2
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/* Includes ----------------------------------------------------------*/
+#include <avr/eeprom.h>     // EEPROM handling
+#include <avr/interrupt.h>  // Interrupts standard C library for AVR-GCC
+#include <util/crc16.h>     // CRC computations
+#include "eventlog.h"
+
+/* Variables ---------------------------------------------------------*/
+// Encoded records waiting for the EEPROM
+static uint8_t queue[EVENTLOG_QUEUE][EVENTLOG_RECORD];
+// EEPROM address of each queued record
+static uint16_t queue_addr[EVENTLOG_QUEUE];
+// Next queue entry to fill, owned by eventlog_add()
+static volatile uint8_t head;
+// Entry being written, owned by interrupt
+static volatile uint8_t tail;
+// Next byte of the entry being written, owned by interrupt
+static uint8_t offset;
+// Slot and sequence number of the next record
+static uint8_t next_slot;
+static uint16_t next_sequence;
+// Records lost because the queue was full
+static uint8_t lost;
+
+/* Function definitions ----------------------------------------------*/
+/**********************************************************************
+ * Function: slot_addr()
+ * Purpose:  EEPROM address of a slot.
+ * Input:    slot - Slot index
+ * Returns:  Address of the first byte
+ **********************************************************************/
+static uint16_t slot_addr(uint8_t slot)
+{
+    return EVENTLOG_EEPROM_ADDR + (uint16_t)slot * EVENTLOG_RECORD;
+}
+
+/**********************************************************************
+ * Function: record_crc()
+ * Purpose:  CRC-8 of record bytes without the CRC itself.
+ * Input:    bytes - Encoded record
+ * Returns:  CRC-8
+ **********************************************************************/
+static uint8_t record_crc(const uint8_t *bytes)
+{
+    uint8_t crc = 0;
+
+    for (uint8_t i = 0; i < EVENTLOG_RECORD - 1; i++)
+        crc = _crc8_ccitt_update(crc, bytes[i]);
+
+    return crc;
+}
+
+/**********************************************************************
+ * Function: read_slot()
+ * Purpose:  Read and decode one slot.
+ * Input:    slot   - Slot index
+ *           record - Where to store the decoded record
+ * Returns:  1 if record is valid, 0 if slot is empty or torn
+ **********************************************************************/
+static uint8_t read_slot(uint8_t slot, eventlog_record_t *record)
+{
+    uint8_t bytes[EVENTLOG_RECORD];
+
+    eeprom_read_block(bytes, (const void *)(uintptr_t)slot_addr(slot), EVENTLOG_RECORD);
+
+    // Type 0xFF marks erased slot even if its CRC matches by chance
+    if (bytes[EVENTLOG_RECORD - 1] != record_crc(bytes) || bytes[6] == 0xFF)
+        return 0;
+
+    record->sequence = bytes[0] | (bytes[1] << 8);
+    record->time_s = bytes[2] | ((uint32_t)bytes[3] << 8) |
+                     ((uint32_t)bytes[4] << 16) | ((uint32_t)bytes[5] << 24);
+    record->type = bytes[6];
+    record->distance = bytes[7] | (bytes[8] << 8);
+
+    return 1;
+}
+
+/**********************************************************************
+ * Function: eventlog_init()
+ * Purpose:  Scan all slots and continue after the record with the
+ *           highest sequence number. Slots hold a window of at most
+ *           EVENTLOG_SLOTS consecutive numbers, so they are compared
+ *           as signed differences and survive the 16-bit wrap-around.
+ * Input:    none
+ * Returns:  Number of valid records in EEPROM
+ **********************************************************************/
+uint8_t eventlog_init()
+{
+    eventlog_record_t record;
+    uint16_t newest = 0;
+    uint8_t newest_slot = 0;
+    uint8_t valid = 0;
+
+    for (uint8_t slot = 0; slot < EVENTLOG_SLOTS; slot++) {
+        if (!read_slot(slot, &record))
+            continue;
+        if (!valid || (int16_t)(record.sequence - newest) > 0) {
+            newest = record.sequence;
+            newest_slot = slot;
+        }
+        ++valid;
+    }
+
+    if (valid) {
+        next_sequence = newest + 1;
+        next_slot = (newest_slot + 1) % EVENTLOG_SLOTS;
+    }
+    else {
+        next_sequence = 0;
+        next_slot = 0;
+    }
+
+    head = 0;
+    tail = 0;
+    offset = 0;
+    lost = 0;
+
+    return valid;
+}
+
+/**********************************************************************
+ * Function: eventlog_add()
+ * Purpose:  Encode record into the RAM queue and let EEPROM ready
+ *           interrupt write it.
+ * Input:    time_s   - Seconds since boot
+ *           type     - Event type
+ *           distance - Filtered distance in cm
+ * Returns:  1 if queued, 0 if the queue was full
+ **********************************************************************/
+uint8_t eventlog_add(uint32_t time_s, uint8_t type, uint16_t distance)
+{
+    uint8_t current = head;
+    uint8_t next = (current + 1) & EVENTLOG_QUEUE_MASK;
+    uint8_t *bytes = queue[current];
+
+    if (next == tail) {
+        if (lost != 0xFF)
+            ++lost;
+        return 0;
+    }
+
+    bytes[0] = next_sequence & 0xFF;
+    bytes[1] = next_sequence >> 8;
+    bytes[2] = time_s & 0xFF;
+    bytes[3] = (time_s >> 8) & 0xFF;
+    bytes[4] = (time_s >> 16) & 0xFF;
+    bytes[5] = time_s >> 24;
+    bytes[6] = type;
+    bytes[7] = distance & 0xFF;
+    bytes[8] = distance >> 8;
+    bytes[9] = record_crc(bytes);
+    queue_addr[current] = slot_addr(next_slot);
+
+    ++next_sequence;
+    if (++next_slot >= EVENTLOG_SLOTS)
+        next_slot = 0;
+
+    // Publish entry only after it is complete
+    head = next;
+    EECR |= (1<<EERIE);
+
+    return 1;
+}
+
+/**********************************************************************
+ * Function: eventlog_read()
+ * Purpose:  Read a record already written to EEPROM.
+ * Input:    age    - 0 for the newest record
+ *           record - Where to store the decoded record
+ * Returns:  1 if record is valid, 0 otherwise
+ **********************************************************************/
+uint8_t eventlog_read(uint8_t age, eventlog_record_t *record)
+{
+    if (age >= EVENTLOG_SLOTS)
+        return 0;
+
+    // Interrupt must not move EEPROM address during the read
+    eventlog_sync();
+
+    return read_slot((next_slot + 2 * EVENTLOG_SLOTS - 1 - age) % EVENTLOG_SLOTS, record);
+}
+
+/**********************************************************************
+ * Function: eventlog_sync()
+ * Purpose:  Wait until the queue is empty and the last write is done,
+ *           interrupts must be enabled.
+ * Input:    none
+ * Returns:  none
+ **********************************************************************/
+void eventlog_sync()
+{
+    while (head != tail || (EECR & (1<<EEPE)))
+        _delay_us(100);
+}
+
+/**********************************************************************
+ * Function: eventlog_get_lost()
+ * Purpose:  Number of records lost because the queue was full.
+ * Input:    none
+ * Returns:  Lost record count
+ **********************************************************************/
+uint8_t eventlog_get_lost()
+{
+    return lost;
+}
+
+/* Interrupt service routines ----------------------------------------*/
+/**********************************************************************
+ * Function: EEPROM ready interrupt
+ * Purpose:  Start programming of the next byte which differs from
+ *           EEPROM content, disable itself when the queue is empty.
+ **********************************************************************/
+ISR(EE_READY_vect)
+{
+    uint8_t current = tail;
+
+    while (current != head) {
+        while (offset < EVENTLOG_RECORD) {
+            uint8_t data = queue[current][offset];
+
+            EEAR = queue_addr[current] + offset;
+            ++offset;
+
+            EECR |= (1<<EERE);
+            if (EEDR != data) {
+                EEDR = data;
+                // EEPE must follow EEMPE within four cycles
+                EECR |= (1<<EEMPE);
+                EECR |= (1<<EEPE);
+                return;
+            }
+        }
+
+        offset = 0;
+        current = (current + 1) & EVENTLOG_QUEUE_MASK;
+        tail = current;
+    }
+
+    EECR &= ~(1<<EERIE);
+}
@@ -0,0 +1,133 @@
+#ifndef EVENTLOG_H_
+#define EVENTLOG_H_
+
+/***********************************************************************
+ *
+ * EEPROM ring log of pump, valve and level events for AVR-GCC.
+ * ATmega328P (Arduino Uno), 16 MHz, AVR 8-bit Toolchain 3.6.2
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/**
+ * @file
+ * @defgroup eventlog EEPROM event log <eventlog.h>
+ * @code #include "eventlog.h" @endcode
+ *
+ * @brief Post-mortem history kept in EEPROM across resets.
+ *
+ * Records are appended round-robin to EVENTLOG_SLOTS slots after the
+ * configuration block, so every slot wears at the same rate. Each
+ * record carries a sequence number and a CRC-8. At boot the slot after
+ * the highest valid sequence number becomes the write position, a
+ * record torn by power loss fails its CRC and is skipped.
+ *
+ * eventlog_add() only copies the record to a small RAM queue. The
+ * EEPROM ready interrupt programs it byte by byte in the background,
+ * skipping bytes which already hold the right value, so callers never
+ * wait for the 3.4 ms write time.
+ *
+ * Record layout, multi-byte fields little endian:
+ *
+ * | Offset | Size | Field                                       |
+ * | ------ | ---- | ------------------------------------------- |
+ * | 0      | 2    | Sequence number                             |
+ * | 2      | 4    | Seconds since boot                          |
+ * | 6      | 1    | Event type, EVENTLOG_*                      |
+ * | 7      | 2    | Filtered distance in cm                     |
+ * | 9      | 1    | CRC-8 (polynomial 0x07) of bytes 0 to 8     |
+ *
+ * @{
+ */
+
+/* Defines -----------------------------------------------------------*/
+#ifndef F_CPU
+#define F_CPU 16000000UL    // CPU frequency in Hz for delay.h
+#endif
+
+/* Includes ----------------------------------------------------------*/
+#include <avr/io.h>         // AVR device-specific IO definitions
+#include <util/delay.h>     // Busy-wait delay loops
+
+/* Defines -----------------------------------------------------------*/
+#define EVENTLOG_EEPROM_ADDR 0x040  // First slot, after configuration
+#define EVENTLOG_EEPROM_END  0x400  // End of 1 KB EEPROM
+#define EVENTLOG_RECORD      10     // Bytes per record
+#define EVENTLOG_SLOTS       ((EVENTLOG_EEPROM_END - EVENTLOG_EEPROM_ADDR) / EVENTLOG_RECORD)
+#define EVENTLOG_QUEUE       4      // Records waiting in RAM, power of two
+#define EVENTLOG_QUEUE_MASK  (EVENTLOG_QUEUE - 1)
+
+// Event types
+#define EVENTLOG_BOOT        1      // Controller started
+#define EVENTLOG_PUMP_ON     2      // Relay switched on
+#define EVENTLOG_PUMP_OFF    3      // Relay switched off
+#define EVENTLOG_VALVE_OPEN  4      // Valve opened
+#define EVENTLOG_VALVE_CLOSE 5      // Valve closed
+#define EVENTLOG_OVERFLOW    6      // Water rose above max level
+#define EVENTLOG_LEVEL       7      // Periodic level history sample
+#define EVENTLOG_NO_ECHO     8      // Level sensor stopped answering
+#define EVENTLOG_STUCK       9      // Level sensor repeats one echo
+#define EVENTLOG_DRY_RUN     10     // Pump did not raise the level
+#define EVENTLOG_WATCHDOG    11     // Reset by watchdog timer
+
+/* Types -------------------------------------------------------------*/
+/** @brief Decoded log record */
+typedef struct {
+    uint16_t sequence;       // Increments with every record
+    uint32_t time_s;         // Seconds since boot
+    uint8_t type;            // EVENTLOG_*
+    uint16_t distance;       // Filtered distance in cm
+} eventlog_record_t;
+
+/* Function prototypes -----------------------------------------------*/
+/**
+ * @name Functions
+ */
+
+/**
+ * @brief  Find write position after the newest valid record.
+ * @param  none
+ * @return Number of valid records in EEPROM
+ */
+uint8_t eventlog_init();
+
+/**
+ * @brief  Queue record for background write, never waits.
+ * @param  time_s   Seconds since boot
+ * @param  type     Event type, EVENTLOG_*
+ * @param  distance Filtered distance in cm
+ * @return 1 if queued, 0 if the queue was full and record was lost
+ */
+uint8_t eventlog_add(uint32_t time_s, uint8_t type, uint16_t distance);
+
+/**
+ * @brief  Read a record already written to EEPROM.
+ * @param  age    0 for the newest record, 1 for the one before, ...
+ * @param  record Where to store the decoded record
+ * @return 1 if record is valid, 0 if slot is empty or torn
+ */
+uint8_t eventlog_read(uint8_t age, eventlog_record_t *record);
+
+/**
+ * @brief  Wait until all queued records are written, e.g. before
+ *         writing other EEPROM data from main loop. Interrupts must
+ *         be enabled.
+ * @param  none
+ * @return none
+ */
+void eventlog_sync();
+
+/**
+ * @brief  Number of records lost because the queue was full.
+ * @param  none
+ * @return Lost record count
+ */
+uint8_t eventlog_get_lost();
+
+/** @} */
+
+#endif /* EVENTLOG_H_ */
@@ -0,0 +1,145 @@
+/***********************************************************************
+ *
+ * Ultrasonic ping filter for AVR-GCC.
+ * ATmega328P (Arduino Uno), 16 MHz, AVR 8-bit Toolchain 3.6.2
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/* Includes ----------------------------------------------------------*/
+#include "filter.h"
+
+/* Variables ---------------------------------------------------------*/
+// Samples in order of arrival
+static uint16_t ring[FILTER_SIZE];
+// The same samples sorted in ascending order
+static uint16_t sorted[FILTER_SIZE];
+// Oldest sample in ring, replaced by the next one
+static uint8_t oldest;
+// Window holds valid samples
+static uint8_t filled;
+// Consecutive samples rejected by slew rate check
+static uint8_t rejects;
+// Output of the current window
+static uint16_t output;
+
+/* Function definitions ----------------------------------------------*/
+/**********************************************************************
+ * Function: filter_update_output()
+ * Purpose:  Compute median or trimmed mean of the sorted window.
+ * Input:    none
+ * Returns:  none
+ **********************************************************************/
+static void filter_update_output()
+{
+#if FILTER_MODE == FILTER_TRIMMED_MEAN
+    uint32_t sum = 0;
+
+    for (uint8_t i = FILTER_TRIM; i < FILTER_SIZE - FILTER_TRIM; i++)
+        sum += sorted[i];
+
+    output = sum / (FILTER_SIZE - 2 * FILTER_TRIM);
+#else
+    output = sorted[FILTER_SIZE / 2];
+#endif
+}
+
+/**********************************************************************
+ * Function: filter_replace()
+ * Purpose:  Replace oldest sample in both buffers.
+ * Input:    sample - New sample
+ * Returns:  none
+ **********************************************************************/
+static void filter_replace(uint16_t sample)
+{
+    uint16_t old = ring[oldest];
+    uint8_t i = 0;
+
+    ring[oldest] = sample;
+    if (++oldest == FILTER_SIZE)
+        oldest = 0;
+
+    // Find the outgoing sample, one of equal values is enough
+    while (sorted[i] != old)
+        ++i;
+
+    // Shift neighbours over its slot until the new sample fits
+    while (i > 0 && sorted[i - 1] > sample) {
+        sorted[i] = sorted[i - 1];
+        --i;
+    }
+    while (i < FILTER_SIZE - 1 && sorted[i + 1] < sample) {
+        sorted[i] = sorted[i + 1];
+        ++i;
+    }
+    sorted[i] = sample;
+}
+
+/**********************************************************************
+ * Function: filter_init()
+ * Purpose:  Forget all samples.
+ * Input:    none
+ * Returns:  none
+ **********************************************************************/
+void filter_init()
+{
+    filled = 0;
+    rejects = 0;
+    oldest = 0;
+    output = 0;
+}
+
+/**********************************************************************
+ * Function: filter_add()
+ * Purpose:  Check slew rate of new sample and add it to the window.
+ * Input:    sample - Raw reading
+ * Returns:  1 if sample was accepted, 0 if rejected as outlier
+ **********************************************************************/
+uint8_t filter_add(uint16_t sample)
+{
+#if FILTER_MAX_SLEW
+    if (filled) {
+        uint16_t step = (sample > output) ? sample - output : output - sample;
+
+        if (step > FILTER_MAX_SLEW) {
+            if (++rejects <= FILTER_MAX_REJECTS)
+                return 0;
+            // Jump persists, level has really changed
+            filled = 0;
+        }
+    }
+#endif
+
+    rejects = 0;
+
+    if (!filled) {
+        // First sample stands for the whole window
+        for (uint8_t i = 0; i < FILTER_SIZE; i++) {
+            ring[i] = sample;
+            sorted[i] = sample;
+        }
+        filled = 1;
+        output = sample;
+        return 1;
+    }
+
+    filter_replace(sample);
+    filter_update_output();
+
+    return 1;
+}
+
+/**********************************************************************
+ * Function: filter_get()
+ * Purpose:  Filtered value of the current window.
+ * Input:    none
+ * Returns:  Median or trimmed mean
+ **********************************************************************/
+uint16_t filter_get()
+{
+    return output;
+}
@@ -0,0 +1,89 @@
+#ifndef FILTER_H_
+#define FILTER_H_
+
+/***********************************************************************
+ *
+ * Ultrasonic ping filter for AVR-GCC.
+ * ATmega328P (Arduino Uno), 16 MHz, AVR 8-bit Toolchain 3.6.2
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/**
+ * @file
+ * @defgroup filter Ultrasonic ping filter <filter.h>
+ * @code #include "filter.h" @endcode
+ *
+ * @brief Rejects spurious echoes before they reach control logic.
+ *
+ * Samples first pass a slew rate check against the filtered value. A
+ * jump larger than FILTER_MAX_SLEW is dropped unless it repeats more
+ * than FILTER_MAX_REJECTS times in a row, then the window restarts at
+ * the new level. Accepted samples are kept in a ring buffer in arrival
+ * order and in a sorted copy, which is updated by one O(N) removal and
+ * insertion per sample. Output is the median or the mean of the sorted
+ * window without FILTER_TRIM smallest and largest samples.
+ *
+ * @{
+ */
+
+/* Includes ----------------------------------------------------------*/
+#include <avr/io.h>         // AVR device-specific IO definitions
+
+/* Defines -----------------------------------------------------------*/
+#define FILTER_MEDIAN       0   // Output middle sample of the window
+#define FILTER_TRIMMED_MEAN 1   // Output mean of the trimmed window
+
+#ifndef FILTER_SIZE
+#define FILTER_SIZE         5   // Window length, odd for median
+#endif
+#ifndef FILTER_MODE
+#define FILTER_MODE         FILTER_MEDIAN
+#endif
+#ifndef FILTER_TRIM
+#define FILTER_TRIM         1   // Samples dropped at each end for mean
+#endif
+#ifndef FILTER_MAX_SLEW
+#define FILTER_MAX_SLEW     10  // Max change of one sample, 0 disables
+#endif
+#ifndef FILTER_MAX_REJECTS
+#define FILTER_MAX_REJECTS  3   // Consecutive jumps taken as real change
+#endif
+
+#if FILTER_SIZE <= 2 * FILTER_TRIM
+#error "FILTER_TRIM leaves no samples in the window"
+#endif
+
+/* Function prototypes -----------------------------------------------*/
+/**
+ * @name Functions
+ */
+
+/**
+ * @brief  Forget all samples, next sample fills the whole window.
+ * @param  none
+ * @return none
+ */
+void filter_init();
+
+/**
+ * @brief  Add new sample to the filter.
+ * @param  sample Raw reading, units are up to the caller
+ * @return 1 if sample was accepted, 0 if rejected as outlier
+ */
+uint8_t filter_add(uint16_t sample);
+
+/**
+ * @brief  Filtered value of the current window.
+ * @param  none
+ * @return Median or trimmed mean, 0 before the first sample
+ */
+uint16_t filter_get();
+
+/** @} */
+
+#endif /* FILTER_H_ */
@@ -0,0 +1,160 @@
+/***********************************************************************
+ *
+ * Fixed-width number formatting for AVR-GCC.
+ * ATmega328P (Arduino Uno), 16 MHz, AVR 8-bit Toolchain 3.6.2
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/* Includes ----------------------------------------------------------*/
+#include <avr/pgmspace.h>   // Program space utilities
+#include <string.h>         // memcpy
+#include "format.h"
+
+/* Defines -----------------------------------------------------------*/
+#define FORMAT_DIGITS 5     // Digits of the largest uint16_t
+
+/* Variables ---------------------------------------------------------*/
+static const uint16_t powers[FORMAT_DIGITS] PROGMEM = {
+    10000, 1000, 100, 10, 1
+};
+
+/* Function definitions ----------------------------------------------*/
+/**********************************************************************
+ * Function: format_digits()
+ * Purpose:  Decimal digits of a number without leading zeros, each
+ *           found by subtracting its power of ten.
+ * Input:    digits - Buffer of FORMAT_DIGITS characters
+ *           value  - Number to convert
+ * Returns:  Number of digits, at least one
+ **********************************************************************/
+static uint8_t format_digits(char *digits, uint16_t value)
+{
+    uint8_t count = 0;
+
+    for (uint8_t i = 0; i < FORMAT_DIGITS; i++) {
+        uint16_t power = pgm_read_word(&powers[i]);
+        char digit = '0';
+
+        while (value >= power) {
+            value -= power;
+            ++digit;
+        }
+        // Units digit is kept even for zero
+        if (count || digit != '0' || i == FORMAT_DIGITS - 1)
+            digits[count++] = digit;
+    }
+
+    return count;
+}
+
+/**********************************************************************
+ * Function: format_fill()
+ * Purpose:  Repeat one character.
+ * Input:    dst   - Destination
+ *           c     - Character to write
+ *           count - Number of characters
+ * Returns:  Position after the written characters
+ **********************************************************************/
+static char *format_fill(char *dst, char c, uint8_t count)
+{
+    while (count--)
+        *dst++ = c;
+
+    return dst;
+}
+
+/**********************************************************************
+ * Function: format_uint()
+ * Purpose:  Unsigned number aligned right in a field.
+ * Input:    dst   - Destination field
+ *           value - Number to write
+ *           width - Field width in characters
+ *           pad   - Leading fill, ' ' or '0'
+ * Returns:  Position after the field
+ **********************************************************************/
+char *format_uint(char *dst, uint16_t value, uint8_t width, char pad)
+{
+    char digits[FORMAT_DIGITS];
+    uint8_t count = format_digits(digits, value);
+
+    if (count > width)
+        return format_fill(dst, FORMAT_OVERFLOW, width);
+
+    dst = format_fill(dst, pad, width - count);
+    memcpy(dst, digits, count);
+
+    return dst + count;
+}
+
+/**********************************************************************
+ * Function: format_fixed1()
+ * Purpose:  Signed fixed-point number with one decimal aligned right
+ *           in a field, whole units if the decimal does not fit.
+ * Input:    dst    - Destination field
+ *           tenths - Number in tenths
+ *           width  - Field width in characters
+ * Returns:  Position after the field
+ **********************************************************************/
+char *format_fixed1(char *dst, int16_t tenths, uint8_t width)
+{
+    char digits[FORMAT_DIGITS];
+    char sign = (tenths > 0) ? '+' : (tenths < 0) ? '-' : ' ';
+    uint16_t magnitude = (tenths < 0) ? -(uint16_t)tenths : (uint16_t)tenths;
+    uint8_t count = format_digits(digits, magnitude);
+    uint8_t whole;
+    uint8_t length;
+
+    // Below one unit the whole part is zero
+    if (count == 1) {
+        digits[1] = digits[0];
+        digits[0] = '0';
+        count = 2;
+    }
+    whole = count - 1;
+
+    // Sign, whole part, point and decimal or sign and whole part only
+    length = whole + 3;
+    if (length > width)
+        length = whole + 1;
+    if (length > width)
+        return format_fill(dst, FORMAT_OVERFLOW, width);
+
+    dst = format_fill(dst, ' ', width - length);
+    *dst++ = sign;
+    memcpy(dst, digits, whole);
+    dst += whole;
+    if (length > whole + 1) {
+        *dst++ = '.';
+        *dst++ = digits[whole];
+    }
+
+    return dst;
+}
+
+/**********************************************************************
+ * Function: format_percent()
+ * Purpose:  Percentage aligned left in a field, padded by spaces.
+ * Input:    dst     - Destination field
+ *           percent - Number to write
+ *           width   - Field width in characters
+ * Returns:  Position after the field
+ **********************************************************************/
+char *format_percent(char *dst, uint8_t percent, uint8_t width)
+{
+    char digits[FORMAT_DIGITS];
+    uint8_t count = format_digits(digits, percent);
+
+    if (count + 1 > width)
+        return format_fill(dst, FORMAT_OVERFLOW, width);
+
+    memcpy(dst, digits, count);
+    dst += count;
+    *dst++ = '%';
+
+    return format_fill(dst, ' ', width - count - 1);
+}
@@ -0,0 +1,76 @@
+#ifndef FORMAT_H_
+#define FORMAT_H_
+
+/***********************************************************************
+ *
+ * Fixed-width number formatting for AVR-GCC.
+ * ATmega328P (Arduino Uno), 16 MHz, AVR 8-bit Toolchain 3.6.2
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/**
+ * @file
+ * @defgroup format Fixed-width number formatting <format.h>
+ * @code #include "format.h" @endcode
+ *
+ * @brief Write numbers into a text buffer field of exact width.
+ *
+ * Every function fills exactly width characters of the destination,
+ * writes no terminating zero and returns the position after the field,
+ * so a whole LCD row is composed by chaining calls. Digits are taken
+ * by repeated subtraction of powers of ten, AVR has no divide
+ * instruction and itoa() needs one library division per digit. A value
+ * which does not fit its field is shown as FORMAT_OVERFLOW characters.
+ *
+ * @{
+ */
+
+/* Includes ----------------------------------------------------------*/
+#include <avr/io.h>         // AVR device-specific IO definitions
+
+/* Defines -----------------------------------------------------------*/
+#define FORMAT_OVERFLOW '*'     // Fills field too narrow for the value
+
+/* Function prototypes -----------------------------------------------*/
+/**
+ * @name Functions
+ */
+
+/**
+ * @brief  Unsigned number aligned right.
+ * @param  dst   Destination field
+ * @param  value Number to write
+ * @param  width Field width in characters
+ * @param  pad   Leading fill, ' ' or '0'
+ * @return Position after the field
+ */
+char *format_uint(char *dst, uint16_t value, uint8_t width, char pad);
+
+/**
+ * @brief  Signed fixed-point number with one decimal aligned right,
+ *         sign is '+', '-' or ' ' for zero. Whole units are shown when
+ *         the decimal does not fit.
+ * @param  dst    Destination field
+ * @param  tenths Number in tenths
+ * @param  width  Field width in characters
+ * @return Position after the field
+ */
+char *format_fixed1(char *dst, int16_t tenths, uint8_t width);
+
+/**
+ * @brief  Percentage aligned left with sign '%', padded by spaces.
+ * @param  dst     Destination field
+ * @param  percent Number to write
+ * @param  width   Field width in characters
+ * @return Position after the field
+ */
+char *format_percent(char *dst, uint8_t percent, uint8_t width);
+
+/** @} */
+
+#endif /* FORMAT_H_ */
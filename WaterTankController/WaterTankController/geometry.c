@@ -0,0 +1,233 @@
+/***********************************************************************
+ *
+ * Tank geometry lookup table for AVR-GCC.
+ * ATmega328P (Arduino Uno), 16 MHz, AVR 8-bit Toolchain 3.6.2
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/* Includes ----------------------------------------------------------*/
+#include "geometry.h"
+
+/* Defines -----------------------------------------------------------*/
+#define PI_NUM  355     // Pi approximated by 355/113
+#define PI_DEN  113
+#define CM3_PER_LITRE 1000UL
+
+/* Variables ---------------------------------------------------------*/
+// Volume in litres at distance i * GEOMETRY_STEP cm
+static uint16_t litres[GEOMETRY_NODES];
+// Fill level in 1/256 % at distance i * GEOMETRY_STEP cm
+static uint16_t percent[GEOMETRY_NODES];
+// Volume of full tank in litres
+static uint16_t capacity;
+// Distances of full and empty tank in cm
+static uint16_t full_distance;
+static uint16_t empty_distance;
+
+/* Function definitions ----------------------------------------------*/
+/**********************************************************************
+ * Function: isqrt()
+ * Purpose:  Integer square root by bit-wise method.
+ * Input:    value - Radicand
+ * Returns:  Square root rounded down
+ **********************************************************************/
+static uint16_t isqrt(uint32_t value)
+{
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+
+    while (bit > value)
+        bit >>= 2;
+
+    while (bit) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return root;
+}
+
+/**********************************************************************
+ * Function: slice_area()
+ * Purpose:  Cross-section of 1 cm slice of water above level y, taken
+ *           in the middle of the slice.
+ * Input:    tank - Tank description
+ *           y    - Bottom of the slice in cm
+ * Returns:  Slice volume in cm3
+ **********************************************************************/
+static uint32_t slice_area(const geometry_t *tank, uint16_t y)
+{
+    uint32_t d = tank->diameter_cm;
+    uint32_t circle = PI_NUM * d * d / (4 * PI_DEN);
+    // Middle of the slice in half centimetres
+    uint32_t m = 2 * y + 1;
+    int32_t offset;
+
+    switch (tank->shape) {
+    case GEOMETRY_HORIZONTAL_CYLINDER:
+        // Chord width at height m/2 is sqrt(d^2 - (d - m)^2) cm, root
+        // is taken in half centimetres and rounded
+        if (m >= 2 * d)
+            return 0;
+        offset = (int32_t)d - (int32_t)m;
+        return ((uint32_t)isqrt(4 * (d * d - offset * offset)) * tank->length_cm + 1) / 2;
+
+    case GEOMETRY_CONICAL_BOTTOM:
+        // Radius grows linearly up to the top of the cone
+        if (y < tank->cone_cm)
+            return circle * m / (2 * tank->cone_cm) * m / (2 * tank->cone_cm);
+        return circle;
+
+    default:
+        return circle;
+    }
+}
+
+/**********************************************************************
+ * Function: calibration_litres()
+ * Purpose:  Interpolate calibration table stored in program memory.
+ * Input:    tank  - Tank description
+ *           level - Water level in cm
+ * Returns:  Volume in litres
+ **********************************************************************/
+static uint16_t calibration_litres(const geometry_t *tank, uint16_t level)
+{
+    uint16_t level0, level1, litres0, litres1;
+    uint8_t i;
+
+    if (!tank->points)
+        return 0;
+
+    for (i = 1; i < tank->points; i++) {
+        if (pgm_read_word(&tank->table[i].level_cm) >= level)
+            break;
+    }
+    if (i == tank->points)
+        return pgm_read_word(&tank->table[i - 1].litres);
+
+    level0 = pgm_read_word(&tank->table[i - 1].level_cm);
+    level1 = pgm_read_word(&tank->table[i].level_cm);
+    litres0 = pgm_read_word(&tank->table[i - 1].litres);
+    litres1 = pgm_read_word(&tank->table[i].litres);
+
+    if (level <= level0)
+        return litres0;
+
+    return litres0 + ((int32_t)litres1 - litres0) * (level - level0) / (level1 - level0);
+}
+
+/**********************************************************************
+ * Function: geometry_init()
+ * Purpose:  Integrate tank volume from the bottom up and store it at
+ *           every table node, nodes lie in descending level order.
+ * Input:    tank - Tank description
+ * Returns:  none
+ **********************************************************************/
+void geometry_init(const geometry_t *tank)
+{
+    uint32_t volume = 0;
+    uint16_t level = 0;
+    int8_t i;
+
+    for (i = GEOMETRY_NODES - 1; i >= 0; i--) {
+        uint16_t distance = (uint16_t)i << GEOMETRY_STEP_SHIFT;
+        uint16_t node_level = 0;
+
+        if (distance < tank->sensor_cm)
+            node_level = tank->sensor_cm - distance;
+        if (node_level > tank->height_cm)
+            node_level = tank->height_cm;
+
+        if (tank->shape == GEOMETRY_CALIBRATION) {
+            litres[i] = calibration_litres(tank, node_level);
+            continue;
+        }
+
+        for (; level < node_level; level++)
+            volume += slice_area(tank, level);
+        litres[i] = (volume + CM3_PER_LITRE / 2) / CM3_PER_LITRE;
+    }
+
+    // Nearest node is at distance 0, above any sensible full level
+    capacity = litres[0];
+    empty_distance = tank->sensor_cm;
+    full_distance = (tank->sensor_cm > tank->height_cm) ? tank->sensor_cm - tank->height_cm : 0;
+
+    for (i = 0; i < GEOMETRY_NODES; i++)
+        percent[i] = capacity ? (uint32_t)litres[i] * (100 << 8) / capacity : 0;
+}
+
+/**********************************************************************
+ * Function: geometry_interpolate()
+ * Purpose:  Read table between two nodes, volume never grows with
+ *           distance, so the difference is not negative.
+ * Input:    table    - Node values
+ *           distance - Distance in cm
+ * Returns:  Interpolated value
+ **********************************************************************/
+static uint16_t geometry_interpolate(const uint16_t *table, uint16_t distance)
+{
+    uint16_t i = distance >> GEOMETRY_STEP_SHIFT;
+    uint8_t fraction = distance & (GEOMETRY_STEP - 1);
+
+    if (i >= GEOMETRY_NODES - 1)
+        return table[GEOMETRY_NODES - 1];
+
+    return table[i] - (((uint32_t)(uint16_t)(table[i] - table[i + 1]) * fraction) >> GEOMETRY_STEP_SHIFT);
+}
+
+/**********************************************************************
+ * Function: geometry_litres()
+ * Purpose:  Water volume at measured distance.
+ * Input:    distance - Distance in cm
+ * Returns:  Volume in litres
+ **********************************************************************/
+uint16_t geometry_litres(uint16_t distance)
+{
+    // Nodes around full and empty level interpolate into the clamped
+    // part of the table
+    if (distance <= full_distance)
+        return capacity;
+    if (distance >= empty_distance)
+        return 0;
+
+    return geometry_interpolate(litres, distance);
+}
+
+/**********************************************************************
+ * Function: geometry_percent()
+ * Purpose:  Fill level at measured distance.
+ * Input:    distance - Distance in cm
+ * Returns:  Volume in percent of full tank
+ **********************************************************************/
+uint8_t geometry_percent(uint16_t distance)
+{
+    if (distance <= full_distance)
+        return 100;
+    if (distance >= empty_distance)
+        return 0;
+
+    return (geometry_interpolate(percent, distance) + 128) >> 8;
+}
+
+/**********************************************************************
+ * Function: geometry_capacity()
+ * Purpose:  Volume of full tank.
+ * Input:    none
+ * Returns:  Volume in litres
+ **********************************************************************/
+uint16_t geometry_capacity()
+{
+    return capacity;
+}
@@ -0,0 +1,109 @@
+#ifndef GEOMETRY_H_
+#define GEOMETRY_H_
+
+/***********************************************************************
+ *
+ * Tank geometry lookup table for AVR-GCC.
+ * ATmega328P (Arduino Uno), 16 MHz, AVR 8-bit Toolchain 3.6.2
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/**
+ * @file
+ * @defgroup geometry Tank geometry <geometry.h>
+ * @code #include "geometry.h" @endcode
+ *
+ * @brief Converts measured distance to water volume.
+ *
+ * geometry_init() integrates the tank cross-section once and stores
+ * volume at every GEOMETRY_STEP cm of sensor distance. Conversion of
+ * a measurement is then a table lookup and linear interpolation by
+ * shift, without any division.
+ *
+ * @{
+ */
+
+/* Includes ----------------------------------------------------------*/
+#include <avr/io.h>         // AVR device-specific IO definitions
+#include <avr/pgmspace.h>   // Program space utilities
+
+/* Defines -----------------------------------------------------------*/
+#define GEOMETRY_STEP_SHIFT 3                          // 8 cm table step
+#define GEOMETRY_STEP       (1 << GEOMETRY_STEP_SHIFT)
+#define GEOMETRY_MAX_CM     512                        // Max sensor distance
+#define GEOMETRY_NODES      (GEOMETRY_MAX_CM / GEOMETRY_STEP + 1)
+// Largest cylinder keeps volume of a full tank below 65535 litres,
+// pi * 200^2 * 512 cm3 is 64340 litres
+#define GEOMETRY_MAX_DIAMETER_CM 400
+#define GEOMETRY_MAX_LENGTH_CM   GEOMETRY_MAX_CM
+
+/* Types -------------------------------------------------------------*/
+/** @brief Supported tank shapes */
+typedef enum {
+    GEOMETRY_VERTICAL_CYLINDER,   // Straight walls
+    GEOMETRY_HORIZONTAL_CYLINDER, // Lying cylinder, height is diameter
+    GEOMETRY_CONICAL_BOTTOM,      // Vertical cylinder on a cone
+    GEOMETRY_CALIBRATION          // Measured table in program memory
+} geometry_shape_t;
+
+/** @brief Point of calibration table, levels in ascending order */
+typedef struct {
+    uint16_t level_cm;      // Water level above tank bottom
+    uint16_t litres;        // Volume at this level
+} geometry_point_t;
+
+/** @brief Tank description */
+typedef struct {
+    geometry_shape_t shape;
+    uint16_t sensor_cm;     // Sensor above tank bottom
+    uint16_t height_cm;     // Water level of full tank
+    uint16_t diameter_cm;   // Cylinder diameter
+    uint16_t length_cm;     // Length of horizontal cylinder
+    uint16_t cone_cm;       // Height of conical bottom
+    const geometry_point_t *table; // Calibration table in PROGMEM
+    uint8_t points;         // Number of calibration points
+} geometry_t;
+
+/* Function prototypes -----------------------------------------------*/
+/**
+ * @name Functions
+ */
+
+/**
+ * @brief  Precompute distance to volume table of a tank.
+ * @param  tank Tank description, not referenced after the call,
+ *              dimensions up to GEOMETRY_MAX_DIAMETER_CM and
+ *              GEOMETRY_MAX_LENGTH_CM
+ * @return none
+ */
+void geometry_init(const geometry_t *tank);
+
+/**
+ * @brief  Water volume at measured distance.
+ * @param  distance Distance between sensor and water surface in cm
+ * @return Volume in litres
+ */
+uint16_t geometry_litres(uint16_t distance);
+
+/**
+ * @brief  Fill level at measured distance.
+ * @param  distance Distance between sensor and water surface in cm
+ * @return Volume in percent of full tank, 0 to 100
+ */
+uint8_t geometry_percent(uint16_t distance);
+
+/**
+ * @brief  Volume of full tank.
+ * @param  none
+ * @return Volume in litres
+ */
+uint16_t geometry_capacity();
+
+/** @} */
+
+#endif /* GEOMETRY_H_ */
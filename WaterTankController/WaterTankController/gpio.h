@@ -36,6 +36,39 @@
 #include <avr/io.h>
 
 
+/* Defines -----------------------------------------------------------*/
+/**
+ * @name Pins bound at compile time
+ * A pin is a port letter and a bit, such as
+ * @code #define LED_G B, PB6 @endcode
+ * Every access is a single sbi, cbi, sbis or sbic instruction, use the
+ * functions below when the pin is only known at run time.
+ */
+#define GPIO_PIN_OUTPUT(pin)        GPIO_PIN_OUTPUT_(pin)
+#define GPIO_PIN_INPUT_NOPULL(pin)  GPIO_PIN_INPUT_NOPULL_(pin)
+#define GPIO_PIN_INPUT_PULLUP(pin)  GPIO_PIN_INPUT_PULLUP_(pin)
+#define GPIO_PIN_LOW(pin)           GPIO_PIN_LOW_(pin)
+#define GPIO_PIN_HIGH(pin)          GPIO_PIN_HIGH_(pin)
+#define GPIO_PIN_TOGGLE(pin)        GPIO_PIN_TOGGLE_(pin)
+/** @brief Nonzero if pin is high */
+#define GPIO_PIN_READ(pin)          GPIO_PIN_READ_(pin)
+/** @brief Bit of pin in its port registers */
+#define GPIO_PIN_MASK(pin)          GPIO_PIN_MASK_(pin)
+
+// Second level expands the port and bit pair into two arguments
+#define GPIO_PIN_OUTPUT_(port, bit)  (DDR##port |= (1<<(bit)))
+#define GPIO_PIN_INPUT_NOPULL_(port, bit) \
+    do { DDR##port &= ~(1<<(bit)); PORT##port &= ~(1<<(bit)); } while (0)
+#define GPIO_PIN_INPUT_PULLUP_(port, bit) \
+    do { DDR##port &= ~(1<<(bit)); PORT##port |= (1<<(bit)); } while (0)
+#define GPIO_PIN_LOW_(port, bit)     (PORT##port &= ~(1<<(bit)))
+#define GPIO_PIN_HIGH_(port, bit)    (PORT##port |= (1<<(bit)))
+// Writing one to Pin Register toggles the output
+#define GPIO_PIN_TOGGLE_(port, bit)  (PIN##port = (1<<(bit)))
+#define GPIO_PIN_READ_(port, bit)    (PIN##port & (1<<(bit)))
+#define GPIO_PIN_MASK_(port, bit)    (1<<(bit))
+
+
 /* Function prototypes -----------------------------------------------*/
 /**
  * @name Functions
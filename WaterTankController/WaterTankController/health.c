@@ -0,0 +1,174 @@
+/***********************************************************************
+ *
+ * Sensor and pump fault detection for AVR-GCC.
+ * ATmega328P (Arduino Uno), 16 MHz, AVR 8-bit Toolchain 3.6.2
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/* Includes ----------------------------------------------------------*/
+#include "health.h"
+
+/* Variables ---------------------------------------------------------*/
+// Active HEALTH_* faults
+static uint8_t faults;
+// Consecutive pings without echo
+static uint8_t misses;
+// Echo length the following echoes are compared with
+static uint16_t window_ticks;
+// Echo has left the window since the last pump check
+static uint8_t echo_moved;
+// Pump was running at the last check
+static uint8_t was_running;
+// Time when the echo left the window last while pump was running
+static uint32_t still_s;
+// Lowest distance reached since pump start and when it was reached
+static uint16_t progress_cm;
+static uint32_t progress_s;
+// Time when dry running was detected
+static uint32_t dry_since;
+
+/* Function definitions ----------------------------------------------*/
+/**********************************************************************
+ * Function: health_raise()
+ * Purpose:  Set faults.
+ * Input:    mask - Faults found by a check
+ * Returns:  Faults which were not active before
+ **********************************************************************/
+static uint8_t health_raise(uint8_t mask)
+{
+    uint8_t raised = mask & ~faults;
+
+    faults |= mask;
+
+    return raised;
+}
+
+/**********************************************************************
+ * Function: health_echo_received()
+ * Purpose:  Clear lost echo, note echo leaving the window around the
+ *           last accepted length.
+ * Input:    echo_ticks - Echo length in TIM1 ticks
+ * Returns:  Faults raised by this call
+ **********************************************************************/
+uint8_t health_echo_received(uint16_t echo_ticks)
+{
+    uint16_t change;
+
+    misses = 0;
+    faults &= ~HEALTH_NO_ECHO;
+
+    change = (echo_ticks > window_ticks) ? echo_ticks - window_ticks
+                                         : window_ticks - echo_ticks;
+    if (change > HEALTH_STUCK_TICKS) {
+        window_ticks = echo_ticks;
+        echo_moved = 1;
+        faults &= ~HEALTH_STUCK;
+    }
+
+    return 0;
+}
+
+/**********************************************************************
+ * Function: health_echo_missed()
+ * Purpose:  Count pings without echo.
+ * Input:    none
+ * Returns:  Faults raised by this call
+ **********************************************************************/
+uint8_t health_echo_missed()
+{
+    if (misses < HEALTH_MAX_MISSES)
+        ++misses;
+    if (misses >= HEALTH_MAX_MISSES)
+        return health_raise(HEALTH_NO_ECHO);
+
+    return 0;
+}
+
+/**********************************************************************
+ * Function: health_pump_check()
+ * Purpose:  Track echo and level progress while pump runs, release
+ *           stuck sensor by pump switch and dry run fault by pump
+ *           switch or after rest time.
+ * Input:    running  - Pump relay is on
+ *           enabled  - Pump switch is on
+ *           distance - Filtered distance in cm
+ *           now_s    - Current time in seconds
+ * Returns:  Faults raised by this call
+ **********************************************************************/
+uint8_t health_pump_check(uint8_t running, uint8_t enabled,
+                          uint16_t distance, uint32_t now_s)
+{
+    uint8_t raised = 0;
+
+    if (!enabled)
+        faults &= ~HEALTH_STUCK;
+    if (faults & HEALTH_DRY_RUN) {
+        if (!enabled || now_s - dry_since >= HEALTH_DRY_RETRY_S)
+            faults &= ~HEALTH_DRY_RUN;
+    }
+
+    if (!running) {
+        was_running = 0;
+        return 0;
+    }
+
+    if (!was_running) {
+        was_running = 1;
+        echo_moved = 1;
+        progress_cm = distance;
+        progress_s = now_s;
+    }
+
+    // Still water may repeat its echo, running pump must move it
+    if (echo_moved) {
+        echo_moved = 0;
+        still_s = now_s;
+    }
+    else if (now_s - still_s >= HEALTH_STUCK_S) {
+        raised |= health_raise(HEALTH_STUCK);
+    }
+
+    // Rising water shortens the distance
+    if (distance + HEALTH_DRY_RUN_CM <= progress_cm) {
+        progress_cm = distance;
+        progress_s = now_s;
+    }
+    else if (now_s - progress_s >= HEALTH_DRY_RUN_S) {
+        dry_since = now_s;
+        raised |= health_raise(HEALTH_DRY_RUN);
+    }
+
+    return raised;
+}
+
+/**********************************************************************
+ * Function: health_get_faults()
+ * Purpose:  Active faults.
+ * Input:    none
+ * Returns:  Bit mask of HEALTH_* faults
+ **********************************************************************/
+uint8_t health_get_faults()
+{
+    return faults;
+}
+
+/**********************************************************************
+ * Function: health_get_code()
+ * Purpose:  Number of the most important active fault.
+ * Input:    none
+ * Returns:  0 if healthy, 1 no echo, 2 stuck, 3 dry run
+ **********************************************************************/
+uint8_t health_get_code()
+{
+    for (uint8_t code = 0; code < 8; code++) {
+        if (faults & (1<<code))
+            return code + 1;
+    }
+
+    return 0;
+}
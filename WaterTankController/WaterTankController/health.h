@@ -0,0 +1,101 @@
+#ifndef HEALTH_H_
+#define HEALTH_H_
+
+/***********************************************************************
+ *
+ * Sensor and pump fault detection for AVR-GCC.
+ * ATmega328P (Arduino Uno), 16 MHz, AVR 8-bit Toolchain 3.6.2
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/**
+ * @file
+ * @defgroup health Fault detection <health.h>
+ * @code #include "health.h" @endcode
+ *
+ * @brief Watches ultrasonic echoes and pump effect, reports faults.
+ *
+ * HEALTH_NO_ECHO is raised after HEALTH_MAX_MISSES pings in a row
+ * without echo and cleared by the next echo. Echo of still water may
+ * repeat the same length for ever, so HEALTH_STUCK is raised only when
+ * the pump runs for HEALTH_STUCK_S and no echo leaves the window of
+ * HEALTH_STUCK_TICKS around the last accepted one. A level rising at
+ * the dry run limit moves about 10 mm in that time, the window is
+ * 1 mm. The fault is cleared by an echo out of the window or by
+ * turning the pump switch off. HEALTH_DRY_RUN is raised when the pump
+ * runs for HEALTH_DRY_RUN_S without raising the level by
+ * HEALTH_DRY_RUN_CM. It stays until the pump switch is turned off or
+ * HEALTH_DRY_RETRY_S passed, then the pump may try again.
+ *
+ * The module only detects, the caller decides on safe state.
+ *
+ * @{
+ */
+
+/* Includes ----------------------------------------------------------*/
+#include <avr/io.h>         // AVR device-specific IO definitions
+
+/* Defines -----------------------------------------------------------*/
+#define HEALTH_NO_ECHO     (1<<0)   // Sensor does not answer
+#define HEALTH_STUCK       (1<<1)   // Echo stands still, pump runs
+#define HEALTH_DRY_RUN     (1<<2)   // Pump runs, level does not rise
+
+#define HEALTH_MAX_MISSES  8        // Pings without echo
+#define HEALTH_STUCK_S     30       // Pump time without echo change
+#define HEALTH_STUCK_TICKS 12       // Echo window, about 1 mm
+#define HEALTH_DRY_RUN_S   60       // Pump time without level rise
+#define HEALTH_DRY_RUN_CM  2        // Expected level rise
+#define HEALTH_DRY_RETRY_S 1800     // Rest before pump tries again
+
+/* Function prototypes -----------------------------------------------*/
+/**
+ * @name Functions
+ */
+
+/**
+ * @brief  Account completed echo.
+ * @param  echo_ticks Echo length in TIM1 ticks
+ * @return Faults raised by this call
+ */
+uint8_t health_echo_received(uint16_t echo_ticks);
+
+/**
+ * @brief  Account ping which timed out.
+ * @param  none
+ * @return Faults raised by this call
+ */
+uint8_t health_echo_missed();
+
+/**
+ * @brief  Check that running pump raises the level.
+ * @param  running  Pump relay is on
+ * @param  enabled  Pump switch is on
+ * @param  distance Filtered distance in cm
+ * @param  now_s    Current time in seconds
+ * @return Faults raised by this call
+ */
+uint8_t health_pump_check(uint8_t running, uint8_t enabled,
+                          uint16_t distance, uint32_t now_s);
+
+/**
+ * @brief  Active faults.
+ * @param  none
+ * @return Bit mask of HEALTH_* faults
+ */
+uint8_t health_get_faults();
+
+/**
+ * @brief  Number of the most important active fault for display.
+ * @param  none
+ * @return 0 if healthy, 1 no echo, 2 stuck, 3 dry run
+ */
+uint8_t health_get_code();
+
+/** @} */
+
+#endif /* HEALTH_H_ */
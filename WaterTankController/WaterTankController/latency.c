@@ -0,0 +1,37 @@
+/***********************************************************************
+ *
+ * Interrupt latency monitor for AVR-GCC.
+ * ATmega328P (Arduino Uno), 16 MHz, AVR 8-bit Toolchain 3.6.2
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/* Includes ----------------------------------------------------------*/
+#include <util/atomic.h>    // Atomically and Non-Atomically Executed Code Blocks
+#include "latency.h"
+
+/* Variables ---------------------------------------------------------*/
+volatile uint16_t latency_max_ticks = 0;
+
+/* Function definitions ----------------------------------------------*/
+/**********************************************************************
+ * Function: latency_get_max()
+ * Purpose:  Worst latency since reset.
+ * Input:    none
+ * Returns:  Latency in TIM1 ticks
+ **********************************************************************/
+uint16_t latency_get_max()
+{
+    uint16_t ticks;
+
+    // Written by interrupts, read in one piece
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        ticks = latency_max_ticks;
+    }
+
+    return ticks;
+}
@@ -0,0 +1,70 @@
+#ifndef LATENCY_H_
+#define LATENCY_H_
+
+/***********************************************************************
+ *
+ * Interrupt latency monitor for AVR-GCC.
+ * ATmega328P (Arduino Uno), 16 MHz, AVR 8-bit Toolchain 3.6.2
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/**
+ * @file
+ * @defgroup latency Interrupt latency monitor <latency.h>
+ * @code #include "latency.h" @endcode
+ *
+ * @brief Worst delay between a scheduled compare match and the entry
+ *        of its interrupt service routine.
+ *
+ * A timer ISR reads its counter at entry and records how far it has
+ * run past the compare value which raised the interrupt, e.g.
+ * @code latency_record(TCNT1 - OCR1B); @endcode
+ * The delay is caused by other ISRs and by code running with
+ * interrupts disabled, so it shows how late time-critical edges can
+ * be. All values are in TIM1 ticks of 0.5 us, timers with another
+ * prescaler scale their counts before recording.
+ *
+ * latency_record() is inline, a function call from an ISR would make
+ * it save all call-clobbered registers.
+ *
+ * @{
+ */
+
+/* Includes ----------------------------------------------------------*/
+#include <avr/io.h>         // AVR device-specific IO definitions
+
+/* Variables ---------------------------------------------------------*/
+// Worst latency so far, written by interrupts only
+extern volatile uint16_t latency_max_ticks;
+
+/* Function prototypes -----------------------------------------------*/
+/**
+ * @name Functions
+ */
+
+/**
+ * @brief  Account latency of one interrupt, call from ISR only.
+ * @param  ticks Counter ticks since the compare match in TIM1 ticks
+ * @return none
+ */
+static inline void latency_record(uint16_t ticks)
+{
+    if (ticks > latency_max_ticks)
+        latency_max_ticks = ticks;
+}
+
+/**
+ * @brief  Worst latency since reset.
+ * @param  none
+ * @return Latency in TIM1 ticks of 0.5 us
+ */
+uint16_t latency_get_max();
+
+/** @} */
+
+#endif /* LATENCY_H_ */
@@ -31,6 +31,11 @@
 #endif
 #include <util/delay.h>
 #include "lcd.h"
+#if LCD_ASYNC_MODE
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include "latency.h"
+#endif
 
 /*
 ** constants/macros
@@ -78,6 +83,12 @@
 #endif
 #endif
 
+#if LCD_ASYNC_MODE
+#define LCD_ASYNC_QUEUE_MASK (LCD_ASYNC_QUEUE_SIZE - 1)
+/* Timer/Counter1 runs with prescaler 8, i.e. 2 ticks per micro second */
+#define LCD_ASYNC_TICKS(us) ((uint16_t)((F_CPU / 8000000UL) * (us)))
+#endif
+
 /*
 ** function prototypes
 */
@@ -85,6 +96,16 @@
 static void toggle_e(void);
 #endif
 
+#if LCD_ASYNC_MODE
+/*
+** transmit queue, head is written by lcd_write(), tail by the interrupt
+*/
+static volatile uint8_t lcd_queue_data[LCD_ASYNC_QUEUE_SIZE];
+static volatile uint8_t lcd_queue_rs[LCD_ASYNC_QUEUE_SIZE];
+static volatile uint8_t lcd_queue_head;
+static volatile uint8_t lcd_queue_tail;
+#endif
+
 /*
 ** local functions
 */
@@ -114,7 +135,11 @@ static void toggle_e(void)
 *  Returns:  none
 *************************************************************************/
 #if LCD_IO_MODE
+#if LCD_ASYNC_MODE
+static void lcd_write_sync(uint8_t data, uint8_t rs)
+#else
 static void lcd_write(uint8_t data, uint8_t rs)
+#endif
 {
     unsigned char dataBits;
 
@@ -196,8 +221,85 @@ static void lcd_write(uint8_t data, uint8_t rs)
          * Delay MUST be greater than 679 us
          */
         _delay_us(750);
+
+        /* clear display and return home take much longer */
+        if (!rs && data < _BV(LCD_ENTRY_MODE))
+            _delay_us(LCD_DELAY_ASYNC_CLEAR - 750);
+    }
+} /* lcd_write */
+
+#if LCD_ASYNC_MODE
+/*************************************************************************
+*  Output one nibble on data lines and toggle Enable pin
+*  Input:    nibble   4 bits to write in bits 3..0
+*  Returns:  none
+*************************************************************************/
+static inline void lcd_write_nibble(uint8_t nibble)
+{
+    if ((&LCD_DATA0_PORT == &LCD_DATA1_PORT) && (&LCD_DATA1_PORT == &LCD_DATA2_PORT) && (&LCD_DATA2_PORT == &LCD_DATA3_PORT) &&
+        (LCD_DATA0_PIN == 0) && (LCD_DATA1_PIN == 1) && (LCD_DATA2_PIN == 2) && (LCD_DATA3_PIN == 3))
+    {
+        LCD_DATA0_PORT = (LCD_DATA0_PORT & 0xF0) | (nibble & 0x0F);
+    }
+    else
+    {
+        LCD_DATA3_PORT &= ~_BV(LCD_DATA3_PIN);
+        LCD_DATA2_PORT &= ~_BV(LCD_DATA2_PIN);
+        LCD_DATA1_PORT &= ~_BV(LCD_DATA1_PIN);
+        LCD_DATA0_PORT &= ~_BV(LCD_DATA0_PIN);
+        if (nibble & 0x08)
+            LCD_DATA3_PORT |= _BV(LCD_DATA3_PIN);
+        if (nibble & 0x04)
+            LCD_DATA2_PORT |= _BV(LCD_DATA2_PIN);
+        if (nibble & 0x02)
+            LCD_DATA1_PORT |= _BV(LCD_DATA1_PIN);
+        if (nibble & 0x01)
+            LCD_DATA0_PORT |= _BV(LCD_DATA0_PIN);
+    }
+    lcd_e_toggle();
+}
+
+/*************************************************************************
+*  Queue byte for interrupt-driven transmission
+*  Input:    data   byte to write to LCD
+*         rs     1: write data
+*                0: write instruction
+*  Returns:  none
+*************************************************************************/
+static void lcd_write(uint8_t data, uint8_t rs)
+{
+    uint8_t next;
+
+    /* interrupts disabled (start-up): nothing would drain the queue */
+    if (!(SREG & _BV(SREG_I)) && lcd_queue_head == lcd_queue_tail)
+    {
+        lcd_write_sync(data, rs);
+        return;
+    }
+
+    /* wait for free slot, transmit interrupt is running */
+    next = (lcd_queue_head + 1) & LCD_ASYNC_QUEUE_MASK;
+    while (next == lcd_queue_tail)
+    {
+        delay(LCD_DELAY_ASYNC_POLL);
+    }
+
+    lcd_queue_data[lcd_queue_head] = data;
+    lcd_queue_rs[lcd_queue_head] = rs;
+    lcd_queue_head = next;
+
+    /* start transmit interrupt if it stopped on empty queue */
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        if (!(TIMSK1 & _BV(OCIE1A)))
+        {
+            OCR1A = TCNT1 + LCD_ASYNC_TICKS(LCD_DELAY_ENABLE_PULSE);
+            TIFR1 = _BV(OCF1A);
+            TIMSK1 |= _BV(OCIE1A);
+        }
     }
 } /* lcd_write */
+#endif /* LCD_ASYNC_MODE */
 
 #else /* if LCD_IO_MODE */
 #define lcd_write(d, rs)                        \
@@ -622,6 +724,34 @@ void lcd_show(uint8_t x, uint8_t y, const char *s)
     lcd_puts(s);
 }
 
+/**********************************************************************
+ * Function: Display LCD string from program memory at set position
+ * Purpose:  Based on arguments coordinates, displays string stored in
+ *			 program memory at set location
+ * Returns:  none
+ **********************************************************************/
+void lcd_show_p(uint8_t x, uint8_t y, const char *progmem_s)
+{
+    lcd_gotoxy(x, y);
+    lcd_puts_p(progmem_s);
+}
+
+/**********************************************************************
+ * Function: Load custom characters from program memory
+ * Purpose:  Copies 8-row bitmaps to CGRAM starting with character 0,
+ *			 then returns to DDRAM address 0
+ * Returns:  none
+ **********************************************************************/
+void lcd_load_glyphs_p(const uint8_t *progmem_glyphs, uint8_t count)
+{
+    lcd_command(1 << LCD_CGRAM);
+
+    for (uint8_t i = 0; i < count * 8; i++)
+        lcd_data(pgm_read_byte(&progmem_glyphs[i]));
+
+    lcd_command(1 << LCD_DDRAM);
+}
+
 /**********************************************************************
  * Function: Display LCD char at set position
  * Purpose:  Based on arguments coordinates, displays char at set
@@ -633,3 +763,69 @@ void lcd_showc(uint8_t x, uint8_t y, char c)
     lcd_gotoxy(x, y);
     lcd_putc(c);
 }
+
+#if LCD_ASYNC_MODE
+/*************************************************************************
+*  Check whether transmit queue is empty and LCD is idle
+*  Returns:  1 if all queued bytes were sent, 0 otherwise
+*************************************************************************/
+uint8_t lcd_idle(void)
+{
+    /* interrupt stops itself one byte delay after the last byte */
+    return !(TIMSK1 & _BV(OCIE1A));
+}
+
+/*************************************************************************
+*  Wait until transmit queue is empty and last byte was processed
+*  Returns:  none
+*************************************************************************/
+void lcd_flush(void)
+{
+    while (!lcd_idle())
+    {
+        delay(LCD_DELAY_ASYNC_POLL);
+    }
+}
+
+/*************************************************************************
+*  Timer/Counter1 compare match A interrupt
+*  Sends one queued byte per tick, next tick is scheduled relative to the
+*  current one after the time the LCD needs to process the byte.
+*************************************************************************/
+ISR(TIMER1_COMPA_vect)
+{
+    uint8_t tail = lcd_queue_tail;
+    uint8_t data;
+
+    latency_record(TCNT1 - OCR1A);
+
+    if (tail == lcd_queue_head)
+    {
+        /* queue empty and last byte processed, stop until next write */
+        TIMSK1 &= ~_BV(OCIE1A);
+        return;
+    }
+
+    data = lcd_queue_data[tail];
+    if (lcd_queue_rs[tail])
+    {
+        lcd_rs_high();
+        OCR1A += LCD_ASYNC_TICKS(LCD_DELAY_ASYNC_BYTE);
+    }
+    else
+    {
+        lcd_rs_low();
+        /* clear display and return home take much longer */
+        if (data < _BV(LCD_ENTRY_MODE))
+            OCR1A += LCD_ASYNC_TICKS(LCD_DELAY_ASYNC_CLEAR);
+        else
+            OCR1A += LCD_ASYNC_TICKS(LCD_DELAY_ASYNC_BYTE);
+    }
+
+    /* output high nibble first, then low nibble */
+    lcd_write_nibble(data >> 4);
+    lcd_write_nibble(data);
+
+    lcd_queue_tail = (tail + 1) & LCD_ASYNC_QUEUE_MASK;
+}
+#endif /* LCD_ASYNC_MODE */
@@ -115,6 +115,28 @@
  */
 #define LCD_IO_MODE 1 /**< 0: memory mapped mode, 1: IO port mode */
 
+/**
+ * @name Definitions for asynchronous mode
+ *
+ * In asynchronous mode lcd_command(), lcd_data() and all functions built
+ * on them only store bytes into a transmit queue. Output Compare A
+ * interrupt of the free running Timer/Counter1 (prescaler N=8) sends
+ * one byte per tick, so the caller never waits for the display.
+ * Bytes written while interrupts are globally disabled (lcd_init() at
+ * start-up) are still sent synchronously. Only 4-bit IO port mode is
+ * supported. The default queue takes a full redraw of both rows (one
+ * cursor address and 16 characters per row) without waiting.
+ */
+#ifndef LCD_ASYNC_MODE
+#define LCD_ASYNC_MODE 0 /**< 0: busy-wait writes, 1: interrupt-driven transmit queue */
+#endif
+#ifndef LCD_ASYNC_QUEUE_SIZE
+#define LCD_ASYNC_QUEUE_SIZE 64 /**< size of transmit queue in bytes, must be power of two */
+#endif
+#if LCD_ASYNC_MODE && !LCD_IO_MODE
+#error "asynchronous mode requires 4-bit IO port mode"
+#endif
+
 #if LCD_IO_MODE
 
 #ifndef LCD_PORT
@@ -207,6 +229,15 @@
 #ifndef LCD_DELAY_ENABLE_PULSE
 #define LCD_DELAY_ENABLE_PULSE 1 /**< enable signal pulse width in micro seconds */
 #endif
+#ifndef LCD_DELAY_ASYNC_BYTE
+#define LCD_DELAY_ASYNC_BYTE 750 /**< time in micro seconds between bytes in asynchronous mode */
+#endif
+#ifndef LCD_DELAY_ASYNC_CLEAR
+#define LCD_DELAY_ASYNC_CLEAR 2000 /**< time in micro seconds after clear or home command in asynchronous mode */
+#endif
+#ifndef LCD_DELAY_ASYNC_POLL
+#define LCD_DELAY_ASYNC_POLL 10 /**< time in micro seconds between checks of a full or draining queue */
+#endif
 
 /**
  * @name Definitions for LCD command instructions
@@ -357,10 +388,53 @@ extern void lcd_show(uint8_t x, uint8_t y, const char *s);
  */
 extern void lcd_showc(uint8_t x, uint8_t y, char c);
 
+/**
+ * @brief    Sets cursor to specified position and puts string from program
+ *           memory on LCD
+ *
+ * Using functions lcd_gotoxy and lcd_puts_p
+ * @param    x horizontal position\n (0: left most position)
+ * @param    y vertical position\n (0: first line)
+ * @param    progmem_s string from program memory to be displayed
+ * @return   none
+ * @see      lcd_show_P
+ */
+extern void lcd_show_p(uint8_t x, uint8_t y, const char *progmem_s);
+
+/**
+ * @brief    Load custom characters from program memory to CGRAM
+ *
+ * Character n is defined by bytes 8*n to 8*n+7, one byte per row from top,
+ * cursor returns to DDRAM address 0
+ * @param    progmem_glyphs bitmaps in program memory
+ * @param    count number of characters, at most 8
+ * @return   none
+ */
+extern void lcd_load_glyphs_p(const uint8_t *progmem_glyphs, uint8_t count);
+
+#if LCD_ASYNC_MODE
+/**
+ * @brief    Wait until transmit queue is empty and last byte was processed
+ *
+ * Available only in asynchronous mode, global interrupts must be enabled
+ * @return   none
+ */
+extern void lcd_flush(void);
+
+/**
+ * @brief    Check whether transmit queue is empty and LCD is idle
+ *
+ * Available only in asynchronous mode
+ * @return   1 if all queued bytes were sent, 0 otherwise
+ */
+extern uint8_t lcd_idle(void);
+#endif
+
 /**
  * @brief macros for automatically storing string constant in program memory
  */
 #define lcd_puts_P(__s) lcd_puts_p(PSTR(__s))
+#define lcd_show_P(__x, __y, __s) lcd_show_p(__x, __y, PSTR(__s))
 
 /**@}*/
 
@@ -0,0 +1,140 @@
+/***********************************************************************
+ * 
+ * Shadow framebuffer for HD44780 LCD.
+ * ATmega328P (Arduino Uno), 16 MHz, AVR 8-bit Toolchain 3.6.2
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/* Includes ----------------------------------------------------------*/
+#include "lcd_buffer.h"
+
+/* Variables ---------------------------------------------------------*/
+// Content requested by application
+static char wanted[LCD_LINES][LCD_DISP_LENGTH];
+// Content already sent to LCD
+static char shown[LCD_LINES][LCD_DISP_LENGTH];
+// One bit per line which differs from LCD
+static uint8_t dirty_lines;
+
+/* Function definitions ----------------------------------------------*/
+/**********************************************************************
+ * Function: lcd_buffer_init()
+ * Purpose:  Clear framebuffer, lcd_init() leaves LCD filled with 
+ *           spaces.
+ * Input:    none
+ * Returns:  none
+ **********************************************************************/
+void lcd_buffer_init()
+{
+    for (uint8_t y = 0; y < LCD_LINES; y++) {
+        for (uint8_t x = 0; x < LCD_DISP_LENGTH; x++) {
+            wanted[y][x] = ' ';
+            shown[y][x] = ' ';
+        }
+    }
+
+    dirty_lines = 0;
+}
+
+/**********************************************************************
+ * Function: lcd_buffer_showc()
+ * Purpose:  Write character into framebuffer at specified position.
+ * Input:    x - Horizontal position (0: left most position)
+ *           y - Vertical position (0: first line)
+ *           c - Character or custom character number
+ * Returns:  none
+ **********************************************************************/
+void lcd_buffer_showc(uint8_t x, uint8_t y, char c)
+{
+    if (x >= LCD_DISP_LENGTH || y >= LCD_LINES)
+        return;
+
+    if (wanted[y][x] != c) {
+        wanted[y][x] = c;
+        dirty_lines |= (1<<y);
+    }
+}
+
+/**********************************************************************
+ * Function: lcd_buffer_show()
+ * Purpose:  Write string into framebuffer at specified position.
+ * Input:    x - Horizontal position (0: left most position)
+ *           y - Vertical position (0: first line)
+ *           s - String to be displayed, clipped at end of line
+ * Returns:  none
+ **********************************************************************/
+void lcd_buffer_show(uint8_t x, uint8_t y, const char *s)
+{
+    while (*s && x < LCD_DISP_LENGTH)
+        lcd_buffer_showc(x++, y, *s++);
+}
+
+/**********************************************************************
+ * Function: lcd_buffer_show_p()
+ * Purpose:  Write string from program memory into framebuffer at
+ *           specified position.
+ * Input:    x         - Horizontal position (0: left most position)
+ *           y         - Vertical position (0: first line)
+ *           progmem_s - String in program memory, clipped at end of line
+ * Returns:  none
+ **********************************************************************/
+void lcd_buffer_show_p(uint8_t x, uint8_t y, const char *progmem_s)
+{
+    char c;
+
+    while ((c = pgm_read_byte(progmem_s++)) && x < LCD_DISP_LENGTH)
+        lcd_buffer_showc(x++, y, c);
+}
+
+/**********************************************************************
+ * Function: lcd_buffer_show_row()
+ * Purpose:  Write whole row into framebuffer, zero is custom character
+ *           0 and does not end the row.
+ * Input:    y   - Vertical position (0: first line)
+ *           row - LCD_DISP_LENGTH characters
+ * Returns:  none
+ **********************************************************************/
+void lcd_buffer_show_row(uint8_t y, const char *row)
+{
+    for (uint8_t x = 0; x < LCD_DISP_LENGTH; x++)
+        lcd_buffer_showc(x, y, row[x]);
+}
+
+/**********************************************************************
+ * Function: lcd_buffer_flush()
+ * Purpose:  Send changed cells of the framebuffer to LCD, every run of
+ *           contiguous changed cells needs one cursor address set.
+ * Input:    none
+ * Returns:  none
+ **********************************************************************/
+void lcd_buffer_flush()
+{
+    for (uint8_t y = 0; y < LCD_LINES; y++) {
+        if (!(dirty_lines & (1<<y)))
+            continue;
+
+        uint8_t x = 0;
+        while (x < LCD_DISP_LENGTH) {
+            // Skip cells already shown on LCD
+            if (wanted[y][x] == shown[y][x]) {
+                ++x;
+                continue;
+            }
+
+            // LCD increments cursor after each character of the run
+            lcd_gotoxy(x, y);
+            do {
+                lcd_data(wanted[y][x]);
+                shown[y][x] = wanted[y][x];
+                ++x;
+            } while (x < LCD_DISP_LENGTH && wanted[y][x] != shown[y][x]);
+        }
+
+        dirty_lines &= ~(1<<y);
+    }
+}
@@ -0,0 +1,99 @@
+#ifndef LCD_BUFFER_H_
+#define LCD_BUFFER_H_
+
+/***********************************************************************
+ * 
+ * Shadow framebuffer for HD44780 LCD.
+ * ATmega328P (Arduino Uno), 16 MHz, AVR 8-bit Toolchain 3.6.2
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/**
+ * @file 
+ * @defgroup lcd_buffer Shadow framebuffer <lcd_buffer.h>
+ * @code #include "lcd_buffer.h" @endcode
+ *
+ * @brief Shadow framebuffer layered on Peter Fleury's LCD library.
+ *
+ * Callers write text into a RAM copy of the display. Flush compares
+ * it with what was already sent to the LCD and transfers only changed
+ * cells, each contiguous run of changed cells with a single cursor
+ * address set. Unchanged text costs no LCD bus transaction at all.
+ *
+ * @{
+ */
+
+/* Includes ----------------------------------------------------------*/
+#include "lcd.h"            // Peter Fleury's LCD library
+
+/* Function prototypes -----------------------------------------------*/
+/**
+ * @name Functions
+ */
+
+/**
+ * @brief  Clear framebuffer, call after lcd_init().
+ * @param  none
+ * @return none
+ */
+void lcd_buffer_init();
+
+/**
+ * @brief  Write string into framebuffer at specified position.
+ * @param  x Horizontal position (0: left most position)
+ * @param  y Vertical position (0: first line)
+ * @param  s String to be displayed, clipped at end of line
+ * @return none
+ */
+void lcd_buffer_show(uint8_t x, uint8_t y, const char *s);
+
+/**
+ * @brief  Write string from program memory into framebuffer at
+ *         specified position.
+ * @param  x         Horizontal position (0: left most position)
+ * @param  y         Vertical position (0: first line)
+ * @param  progmem_s String in program memory, clipped at end of line
+ * @return none
+ * @see    lcd_buffer_show_P
+ */
+void lcd_buffer_show_p(uint8_t x, uint8_t y, const char *progmem_s);
+
+/**
+ * @brief  Write whole row into framebuffer, custom character 0 may be
+ *         part of it.
+ * @param  y   Vertical position (0: first line)
+ * @param  row LCD_DISP_LENGTH characters, no terminating zero needed
+ * @return none
+ */
+void lcd_buffer_show_row(uint8_t y, const char *row);
+
+/**
+ * @brief  Write character into framebuffer at specified position.
+ * @param  x Horizontal position (0: left most position)
+ * @param  y Vertical position (0: first line)
+ * @param  c Character or custom character number
+ * @return none
+ */
+void lcd_buffer_showc(uint8_t x, uint8_t y, char c);
+
+/**
+ * @brief  Send changed cells of the framebuffer to LCD.
+ * @param  none
+ * @return none
+ */
+void lcd_buffer_flush();
+
+/**
+ * @brief  Store string constant in program memory and write it into
+ *         framebuffer.
+ */
+#define lcd_buffer_show_P(x, y, s) lcd_buffer_show_p(x, y, PSTR(s))
+
+/** @} */
+
+#endif /* LCD_BUFFER_H_ */
@@ -71,6 +71,15 @@
 #define LCD_E_PIN       PB1
 // R/W pin is connected to GND on LCD Keypad Shield
 
+/**
+ * @name Definitions for asynchronous mode
+ * Bytes are queued and sent by Timer/Counter1 Output Compare A 
+ * interrupt, see lcd.h.
+ */
+#ifndef LCD_ASYNC_MODE
+#define LCD_ASYNC_MODE  1 /**< @brief Use interrupt-driven transmit queue */
+#endif
+
 /** @} */
 
 #endif
@@ -14,11 +14,62 @@
 #define TRIG     PD0     // Trigger Pin
 #define ECHO     PD2     // Echo Pin
 #define SERVO    PB4     // Servo valve pin
-#define LED_G    PB6     // Servo valve pin
-#define LED_R    PB7     // Servo valve pin
-#define RELAY    PC0     // Pin for pump relay control
-#define SW_PUMP  PC1     // Pin for pump switch
-#define SW_SERVO PC2     // Pin for servo valve switch
+#define LED_G    B, PB6  // Pump status LED pin
+#define LED_R    B, PB7  // Valve status LED pin
+#define RELAY    C, PC0  // Pin for pump relay control
+#define SW_PUMP  C, PC1  // Pin for pump switch
+#define SW_SERVO C, PC2  // Pin for servo valve switch
+// Both switches are on port C, PCINT9 and PCINT10
+#define SWITCHES (GPIO_PIN_MASK(SW_PUMP) | GPIO_PIN_MASK(SW_SERVO))
+#define VALVE_OPEN_US   2000 // Servo pulse width for open valve
+#define VALVE_CLOSED_US 1500 // Servo pulse width for closed valve
+
+// Index of ultrasonic sensor measuring water level
+#define SENSOR_LEVEL 0
+
+// Events posted by interrupt service routines
+#define EVENT_ECHO_RECEIVED 1 // Echo of level sensor was timestamped
+#define EVENT_ECHO_TIMEOUT  2 // Level sensor did not answer a ping
+#define EVENT_SWITCH        3 // Manual switch settled at a new position
+
+// Tasks run by cooperative scheduler in main loop
+#define TASK_MEASURE (1<<0) // Convert echo to distance and volume
+#define TASK_CONTROL (1<<1) // Drive valve and pump
+#define TASK_DISPLAY (1<<2) // Update LCD
+#define TASK_TELEMETRY (1<<3) // Report measurement over USART
+#define TASK_MISSED  (1<<4) // Account ping without echo
+
+// Adaptive measurement rate, periods in ms of the system tick
+#define PING_PERIOD_FAST 36  // While level changes
+#define PING_PERIOD_SLOW 252 // While level is stable
+#define STABLE_PINGS     16  // Stable readings before slowing down
+#define STABLE_DELTA_CM  1   // Max level change of a stable reading
+
+// Fill rate prediction
+#define VALVE_LEAD_S  5   // Open valve this long before predicted overflow
+#define RATE_SLICE_CM 10  // Level band for litres per cm of tank
+#define ROW_PAGE_S    3   // Seconds between status and rate on LCD
+
+// Correct speed of sound by on-chip temperature sensor
+#ifndef TEMPERATURE_COMPENSATION
+#define TEMPERATURE_COMPENSATION 1
+#endif
+// Record pump, valve and level history in EEPROM
+#ifndef EVENT_LOG
+#define EVENT_LOG 1
+#endif
+#define LEVEL_HISTORY_S  900  // Level sample every 15 minutes
+#define UPTIME_PERIOD    1000 // Tick ms per uptime second
+#define BLINK_PERIOD     500  // Tick ms per LED toggle
+#define DEBOUNCE_PERIOD  1    // Tick ms per switch sample
+
+// Send one telemetry frame per measurement on TXD
+#ifndef TELEMETRY
+#define TELEMETRY 1
+#endif
+
+// Reset when main loop stops running
+#define WATCHDOG_TIMEOUT WDTO_1S
 #ifndef F_CPU
 #define F_CPU 16000000UL // CPU frequency in Hz for delay.h
 #endif
@@ -26,20 +77,42 @@
 /* Includes ----------------------------------------------------------*/
 #include <avr/interrupt.h> // Interrupts standard C library for AVR-GCC
 #include <avr/io.h>        // AVR device-specific IO definitions
-#include <stdlib.h>        // C library for conversion function
+#include <avr/power.h>     // Power reduction management
+#include <avr/sleep.h>     // Power management and sleep modes
+#include <avr/wdt.h>       // Watchdog timer handling
 #include <string.h>        // C library for string manipulations
+#include <util/atomic.h>   // Atomically executed code blocks
 #include <util/delay.h>    // Busy-wait delay loops
+#include "config.h"        // Persistent configuration in EEPROM
+#include "debounce.h"      // Integrating debouncer of switch inputs
+#include "eventlog.h"      // EEPROM ring log of events
+#include "filter.h"        // Ultrasonic ping filter
+#include "format.h"        // Fixed-width number formatting
+#include "geometry.h"      // Tank geometry lookup table
+#include "health.h"        // Sensor and pump fault detection
 #include "gpio.h"          // GPIO library for AVR-GCC
+#include "latency.h"       // Interrupt latency monitor
 #include "lcd.h"           // Peter Fleury's LCD library
+#include "lcd_buffer.h"    // Shadow framebuffer for HD44780 LCD
+#include "pump.h"          // Pump relay state machine
+#include "queue.h"         // Lock-free event queue
+#include "rate.h"          // Level rate estimator
+#include "servo.h"         // SG90 servo motor library for AVR-GCC
 #include "symbols.h"       // Custom characters for HD44780 LCD
-#include "timer.h"         // Timer library for AVR-GCC
+#include "telemetry.h"     // USART telemetry stream
+#include "temperature.h"   // Internal temperature sensor library
+#include "tick.h"          // Millisecond tick and timer wheel
 #include "ultrasonic.h"    // Ultrasonic sensor library for AVR-GCC
 
 /* Variables ---------------------------------------------------------*/
-// Max water height in cm
-uint16_t water_height = 400;
+// Ultrasonic sensors, triggered one after another
+ultrasonic_sensor_t sensors[] = {
+    [SENSOR_LEVEL] = ULTRASONIC_SENSOR(&DDRD, TRIG, &DDRD, ECHO),
+};
+// Max water height in cm, loaded from EEPROM
+uint16_t water_height;
 // Gap between sensor and max water height in cm
-uint16_t air_gap = 20;
+uint16_t air_gap;
 // Total height of the system
 uint16_t total_height;
 // Max water level before valve opens
@@ -47,17 +120,114 @@ uint16_t max_level;
 
 // Measured distance in cm
 uint16_t distance;
-// Water tank fill level
+// Distance of the last ping before filtering in cm
+uint16_t raw_distance;
+// Last sample of the level sensor taken by measurement task
+ultrasonic_sample_t level_sample;
+// Water tank fill level in %
 uint8_t volume = 0;
+// Water volume in litres
+uint16_t litres = 0;
+// Inflow minus outflow in dl/min
+int16_t fill_rate = 0;
+// Tank shape and heights, loaded from EEPROM
+geometry_t tank;
+// Volume of an irregular tank measured by filling it, used when the
+// configuration selects GEOMETRY_CALIBRATION
+const geometry_point_t tank_table[] PROGMEM = {
+    {  0,    0}, { 20,   60}, { 50,  300}, {100,  900},
+    {200, 2300}, {300, 3800}, {400, 5300},
+};
 
-// Booleans for electromechanics
+// Boolean for electromechanics, pump state is kept by pump.c
 uint8_t valveIsOpen = 0;
-uint8_t pumpIsOn = 0;
 
 // Custom character number
 uint8_t char_num = 0;
 
+// Tasks waiting to be run by main loop scheduler
+uint8_t pending_tasks = 0;
+// Milliseconds between two pings
+uint16_t ping_period = PING_PERIOD_FAST;
+// Seconds since reset, counted by uptime timer
+volatile uint32_t uptime_s = 0;
+
+// Software timers on the system tick
+soft_timer_t ping_timer;
+soft_timer_t uptime_timer;
+soft_timer_t blink_timer;
+soft_timer_t echo_timer;
+soft_timer_t debounce_timer;
+
+// Last reset was caused by watchdog
+uint8_t reset_by_watchdog = 0;
+
+/* Types -------------------------------------------------------------*/
+// Entry of the main loop scheduler table
+typedef struct {
+    uint8_t mask;        // Task bit in pending_tasks
+    void (*run)(void);   // Task body
+} task_t;
+
 /* Function definitions ----------------------------------------------*/
+/**********************************************************************
+ * Function: Get uptime
+ * Purpose:  Seconds since reset.
+ * Input:    none
+ * Returns:  Uptime in seconds
+ **********************************************************************/
+uint32_t get_uptime()
+{
+    uint32_t now;
+
+    // Written by interrupt, read in one piece
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        now = uptime_s;
+    }
+
+    return now;
+}
+/**********************************************************************
+ * Function: Switch is on
+ * Purpose:  Debounced position of a manual switch.
+ * Input:    mask - Pin of the switch in port C
+ * Returns:  Nonzero if switch is on
+ **********************************************************************/
+uint8_t switch_is_on(uint8_t mask)
+{
+    return debounce_get_state() & mask;
+}
+/**********************************************************************
+ * Function: Log event
+ * Purpose:  Append event with current time and distance to EEPROM
+ *           log, written in background.
+ * Input:    type - Event type EVENTLOG_*
+ * Returns:  none
+ **********************************************************************/
+void log_event(uint8_t type)
+{
+#if EVENT_LOG
+    eventlog_add(get_uptime(), type, distance);
+#else
+    (void)type;
+#endif
+}
+/**********************************************************************
+ * Function: Log faults
+ * Purpose:  Record each newly raised fault once.
+ * Input:    raised - HEALTH_* faults raised by a check
+ * Returns:  none
+ **********************************************************************/
+void log_faults(uint8_t raised)
+{
+    if (raised & HEALTH_NO_ECHO)
+        log_event(EVENTLOG_NO_ECHO);
+    if (raised & HEALTH_STUCK)
+        log_event(EVENTLOG_STUCK);
+    if (raised & HEALTH_DRY_RUN)
+        log_event(EVENTLOG_DRY_RUN);
+}
 /**********************************************************************
  * Function: Pump configuration
  * Purpose:  Start-up pump configuration for control and relay pins.
@@ -67,11 +237,11 @@ uint8_t char_num = 0;
 void configure_pump()
 {
     // Configure Pump switch pin
-    GPIO_config_input_nopull(&DDRC, SW_PUMP);
+    GPIO_PIN_INPUT_NOPULL(SW_PUMP);
 
     // Configure relay control signal pin
-    GPIO_config_output(&DDRC, RELAY);
-    GPIO_write_low(&PORTC, RELAY);
+    GPIO_PIN_OUTPUT(RELAY);
+    GPIO_PIN_LOW(RELAY);
 }
 /**********************************************************************
  * Function: Servo configuration
@@ -81,12 +251,28 @@ void configure_pump()
  **********************************************************************/
 void configure_servo()
 {
-    // Configure Servo control signal pin
-    GPIO_config_output(&DDRB, SERVO);
-    GPIO_write_low(&PORTB, SERVO);
+    // Configure Servo control signal pin and hold valve closed
+    servo_init(&DDRB, SERVO);
+    servo_set_us(VALVE_CLOSED_US);
 
     // Configure Servo switch pin
-    GPIO_config_input_nopull(&DDRC, SW_SERVO);
+    GPIO_PIN_INPUT_NOPULL(SW_SERVO);
+}
+/**********************************************************************
+ * Function: Switches configuration
+ * Purpose:  Take current switch positions and enable pin change
+ *           interrupt of both switches, pins are configured by pump
+ *           and servo configuration.
+ * Input:    none
+ * Returns:  none
+ **********************************************************************/
+void configure_switches()
+{
+    debounce_init(&PINC, SWITCHES);
+
+    // Port C pins PC0 to PC6 are PCINT8 to PCINT14
+    PCMSK1 |= SWITCHES;
+    PCICR |= (1<<PCIE1);
 }
 /**********************************************************************
  * Function: LEDs configuration
@@ -96,22 +282,18 @@ void configure_servo()
  **********************************************************************/
 void configure_leds()
 {
-    GPIO_config_output(&DDRB, LED_G);
-    GPIO_write_low(&PORTB, LED_G);
-    GPIO_config_output(&DDRB, LED_R);
-    GPIO_write_low(&PORTB, LED_R);
+    GPIO_PIN_OUTPUT(LED_G);
+    GPIO_PIN_LOW(LED_G);
+    GPIO_PIN_OUTPUT(LED_R);
+    GPIO_PIN_LOW(LED_R);
 
     // Initialize LCD display
     lcd_init(LCD_DISP_ON);
-    // Set pointer to beginning of CGRAM memory
-    lcd_command(1 << LCD_CGRAM);
+    // Store all new chars to CGRAM straight from flash
+    lcd_load_glyphs_p(customChar, CUSTOM_CHARS);
 
-    // Store all new chars to memory line by line
-    for (uint8_t i = 0; i < 48; i++)
-        lcd_data(customChar[i]);
-
-    // Set DDRAM address
-    lcd_command(1 << LCD_DDRAM);
+    // LCD content is prepared in RAM and flushed by display task
+    lcd_buffer_init();
 }
 /**********************************************************************
  * Function: Initialization of start-up LCD values
@@ -122,26 +304,168 @@ void configure_leds()
  **********************************************************************/
 void set_initial_lcd_values()
 {
-    lcd_show(0, 0, "LVL:");
-    lcd_showc(15, 0, char_num);
-    lcd_show(0, 1, "PMP:");
-    lcd_show(9, 1, "VLV:CLS");
+    lcd_buffer_show_P(0, 0, "LVL:");
+    lcd_buffer_showc(15, 0, char_num);
+    lcd_buffer_show_P(0, 1, "PMP:OFF");
+    lcd_buffer_show_P(9, 1, "VLV:CLS");
+    lcd_buffer_flush();
+}
+/**********************************************************************
+ * Function: Echo timeout
+ * Purpose:  Echo timer callback, give up waiting for the echo and
+ *           notify main loop if the level sensor missed it.
+ * Input:    none
+ * Returns:  none
+ **********************************************************************/
+void echo_timeout()
+{
+    if (ultrasonic_timeout() & (1<<SENSOR_LEVEL))
+        queue_post(EVENT_ECHO_TIMEOUT);
+}
+/**********************************************************************
+ * Function: Sample switches
+ * Purpose:  Debounce timer callback, notify main loop when a switch
+ *           settles at a new position and stop once all rest.
+ * Input:    none
+ * Returns:  none
+ **********************************************************************/
+void sample_switches()
+{
+    if (debounce_sample())
+        queue_post(EVENT_SWITCH);
+
+    if (debounce_is_settled())
+        timer_cancel(&debounce_timer);
 }
 /**********************************************************************
- * Function: Initialization of timer overflows
- * Purpose:  Set start-up initialization of timer overflow interrupts
- *           and global interrupt mask.
+ * Function: Trigger ping
+ * Purpose:  Ping timer callback, trigger next ultrasonic sensor.
  * Input:    none
  * Returns:  none
  **********************************************************************/
-void set_timer_overflows()
+void trigger_ping()
 {
-    // Overflow timer for trigger signal
-    TIM0_overflow_4ms();
-    TIM0_overflow_interrupt_enable();
+    ultrasonic_trigger_next();
 
-    // Set overflow flag for LED timer
-    TIM2_overflow_interrupt_enable();
+    // Missing echo must not be waited for forever
+    timer_after(&echo_timer, ULTRASONIC_TIMEOUT_MS, echo_timeout);
+}
+/**********************************************************************
+ * Function: Count uptime
+ * Purpose:  Uptime timer callback, count one second.
+ * Input:    none
+ * Returns:  none
+ **********************************************************************/
+void count_uptime()
+{
+    ++uptime_s;
+}
+/**********************************************************************
+ * Function: Blink LEDs
+ * Purpose:  Blink timer callback, toggle LED of open valve and running
+ *           pump.
+ * Input:    none
+ * Returns:  none
+ **********************************************************************/
+void blink_leds()
+{
+    if (valveIsOpen)
+        GPIO_PIN_TOGGLE(LED_R);
+
+    if (pump_is_running())
+        GPIO_PIN_TOGGLE(LED_G);
+}
+/**********************************************************************
+ * Function: Start blinking
+ * Purpose:  Start LED blink timer unless it already runs, so the
+ *           blink phase is kept when valve and pump overlap.
+ * Input:    none
+ * Returns:  none
+ **********************************************************************/
+void start_blinking()
+{
+    if (!timer_is_active(&blink_timer))
+        timer_every(&blink_timer, BLINK_PERIOD, blink_leds);
+}
+/**********************************************************************
+ * Function: Initialization of timers
+ * Purpose:  Start system tick with ping and uptime timers.
+ * Input:    none
+ * Returns:  none
+ **********************************************************************/
+void start_timers()
+{
+    tick_init();
+
+    timer_every(&uptime_timer, UPTIME_PERIOD, count_uptime);
+    timer_every(&ping_timer, ping_period, trigger_ping);
+}
+/**********************************************************************
+ * Function: Power configuration
+ * Purpose:  Switch off clock of unused peripherals and select sleep
+ *           mode of the idle main loop. Timer/Counter0 and 1 keep
+ *           running in idle mode only, Timer/Counter2 runs during
+ *           ultrasonic trigger pulse.
+ * Input:    none
+ * Returns:  none
+ **********************************************************************/
+void configure_power()
+{
+    power_adc_disable();
+    power_usart0_disable();
+    power_spi_disable();
+    power_twi_disable();
+
+    set_sleep_mode(SLEEP_MODE_IDLE);
+}
+/**********************************************************************
+ * Function: Pump control configuration
+ * Purpose:  Set hysteresis band and timing of the pump state machine,
+ *           overflow stops pump at once.
+ * Input:    config - Configuration block
+ * Returns:  none
+ **********************************************************************/
+void configure_pump_control(const config_t *config)
+{
+    pump_config_t pump = {
+        .start_cm = config->pump_start,
+        .stop_cm = config->air_gap,
+        .limit_cm = config->max_level,
+        .min_on_s = config->pump_min_on,
+        .min_off_s = config->pump_min_off,
+        .min_cycle_s = config->pump_min_cycle,
+    };
+
+    pump_init(&pump, get_uptime());
+}
+/**********************************************************************
+ * Function: Apply configuration
+ * Purpose:  Take tank dimensions and thresholds from the configuration
+ *           block, call again after any config_set_*().
+ * Input:    none
+ * Returns:  none
+ **********************************************************************/
+void apply_configuration()
+{
+    const config_t *config = config_get();
+
+    water_height = config->water_height;
+    air_gap = config->air_gap;
+    // Derived values are stored with the block
+    max_level = config->max_level;
+    total_height = config->total_height;
+
+    // Precompute distance to volume table
+    tank.shape = config->shape;
+    tank.sensor_cm = total_height;
+    tank.height_cm = water_height;
+    tank.diameter_cm = config->diameter_cm;
+    tank.length_cm = config->length_cm;
+    tank.cone_cm = config->cone_cm;
+    tank.table = config_get_table(&tank.points);
+    geometry_init(&tank);
+
+    configure_pump_control(config);
 }
 /**********************************************************************
  * Function: Initializes configurations
@@ -152,57 +476,74 @@ void set_timer_overflows()
  **********************************************************************/
 void init_configurations()
 {
-    // Set max water level halfway between sensor and max water level
-    max_level = air_gap / 2;
-    // Height of the complete system
-    total_height = water_height + air_gap;
+    // Tank dimensions survive reset in EEPROM, blank one gets defaults
+    config_attach_table(tank_table, sizeof(tank_table) / sizeof(tank_table[0]));
+    config_load();
+    apply_configuration();
+#if EVENT_LOG
+    // Continue after the newest record, log is written by interrupt
+    eventlog_init();
+    log_event(EVENTLOG_BOOT);
+#endif
 
-    // Initialize ultrasonic sensor pins
-    ultrasonic_init(&DDRD, TRIG, &DDRD, ECHO);
+    // Stop clock of unused peripherals
+    configure_power();
+#if TEMPERATURE_COMPENSATION
+    // ADC runs only for the temperature sensor
+    temperature_init();
+#endif
+#if TELEMETRY
+    // USART transmitter only, receiver pin is used by the sensor
+    telemetry_init();
+#endif
+
+    // Initialize ultrasonic sensor pins and ping filter
+    ultrasonic_init(sensors, sizeof(sensors) / sizeof(sensors[0]));
+    filter_init();
     // Initialize water pump pins
     configure_pump();
     // Initialize water valve pins
     configure_servo();
     // Initialize LED pins
     configure_leds();
+    // Watch manual switches by pin change interrupt
+    configure_switches();
 }
 /**********************************************************************
  * Function: Open valve
- * Purpose:  Send 2 ms pulse to open valve and notify it by blinking 
- *           LED.
+ * Purpose:  Set 2 ms servo pulse to open valve and notify it by 
+ *           blinking LED.
  * Input:    none	 
  * Returns:  none
  **********************************************************************/
 void open_valve()
 {
-    GPIO_write_high(&PORTB, SERVO);
-    _delay_ms(2);
-    GPIO_write_low(&PORTB, SERVO);
-    _delay_ms(18);
+    servo_set_us(VALVE_OPEN_US);
+    log_event(EVENTLOG_VALVE_OPEN);
+    rate_reset();
 
     valveIsOpen = 1;
 
-    // Start blinking LED
-    TIM2_overflow_16ms();
+    start_blinking();
 }
 /**********************************************************************
  * Function: Close valve
- * Purpose:  Send 1.5 ms pulse to close valve and stop blinking LED.
+ * Purpose:  Set 1.5 ms servo pulse to close valve and stop blinking 
+ *           LED.
  * Input:    none 
  * Returns:  none
  **********************************************************************/
 void close_valve()
 {
-    GPIO_write_high(&PORTB, SERVO);
-    _delay_ms(1.5);
-    GPIO_write_low(&PORTB, SERVO);
-    _delay_ms(18.5);
+    servo_set_us(VALVE_CLOSED_US);
+    log_event(EVENTLOG_VALVE_CLOSE);
+    rate_reset();
 
     valveIsOpen = 0;
 
     // Stop blinking LED
-    if (!pumpIsOn)
-        TIM2_stop();
+    if (!pump_is_running())
+        timer_cancel(&blink_timer);
 }
 /**********************************************************************
  * Function: Turns on the pump
@@ -213,12 +554,11 @@ void close_valve()
 void pump_on()
 {
     // Turn relay for Pump on
-    GPIO_write_high(&PORTC, RELAY);
+    GPIO_PIN_HIGH(RELAY);
+    log_event(EVENTLOG_PUMP_ON);
+    rate_reset();
 
-    pumpIsOn = 1;
-
-    // Start blinking LED
-    TIM2_overflow_16ms();
+    start_blinking();
 }
 /**********************************************************************
  * Function: Turns off the pump
@@ -228,76 +568,139 @@ void pump_on()
  **********************************************************************/
 void pump_off()
 {
-    GPIO_write_low(&PORTC, RELAY);
-
-    pumpIsOn = 0;
+    GPIO_PIN_LOW(RELAY);
+    log_event(EVENTLOG_PUMP_OFF);
+    rate_reset();
 
     // Stop blinking LED
     if (!valveIsOpen)
-        TIM2_stop();
+        timer_cancel(&blink_timer);
+}
+/**********************************************************************
+ * Function: Shows pump and valve state
+ * Purpose:  Put relay and servo state on second LCD row.
+ * Input:    none
+ * Returns:  none
+ **********************************************************************/
+void show_pump_and_valve()
+{
+    lcd_buffer_show_p(0, 1, pump_is_running() ? PSTR("PMP:ON   ") : PSTR("PMP:OFF  "));
+    lcd_buffer_show_p(9, 1, valveIsOpen ? PSTR("VLV:OPN") : PSTR("VLV:CLS"));
 }
 /**********************************************************************
- * Function: Shows prepared LCD values
- * Purpose:  After preparation of LCD values based on water tank level,
- *           display values on LCD display.
- * Input:    lcd_str    - string for water level status
- *           lcd_smiley - string for smiley :^)
- *           char_num   - char for tank fill level icon
+ * Function: Shows fault
+ * Purpose:  Put code and name of the most important fault on second
+ *           LCD row, e.g. "FAULT 1 NO ECHO ".
+ * Input:    none
  * Returns:  none
  **********************************************************************/
-void show_final_lcd_values(const char *lcd_str, const char *lcd_smiley, const uint8_t char_num)
+void show_fault()
 {
-    // Put tank fill level in % on LCD
-    lcd_show(4, 0, lcd_str);
-    // Put smiley on LCD
-    lcd_show(12, 0, lcd_smiley);
-    // Put cute tank fill level icon on LCD
-    lcd_showc(15, 0, char_num);
+    static const char no_echo[] PROGMEM = "NO ECHO ";
+    static const char stuck[] PROGMEM = "STUCK   ";
+    static const char dry_run[] PROGMEM = "DRY RUN ";
+    static const char *const names[] PROGMEM = {no_echo, stuck, dry_run};
+    uint8_t code = health_get_code();
+
+    lcd_buffer_show_P(0, 1, "FAULT ");
+    lcd_buffer_showc(6, 1, '0' + code);
+    lcd_buffer_showc(7, 1, ' ');
+    lcd_buffer_show_p(8, 1, pgm_read_ptr(&names[code - 1]));
+}
+/**********************************************************************
+ * Function: Shows fill rate
+ * Purpose:  Put flow in l/min and predicted time to full, overflow or
+ *           empty on second LCD row, e.g. "+12.5L/m  F03:20",
+ *           composed in one pass.
+ * Input:    none
+ * Returns:  none
+ **********************************************************************/
+void show_fill_rate()
+{
+    char lcd_row[LCD_DISP_LENGTH];
+    char *pos;
+    char target = ' ';
+    uint16_t seconds = RATE_NEVER;
+
+    // Full level first, overflow once it is exceeded
+    if (fill_rate > 0)
+    {
+        target = (distance > air_gap) ? 'F' : 'O';
+        seconds = rate_seconds_to((distance > air_gap) ? air_gap : max_level, distance);
+    }
+    else if (fill_rate < 0)
+    {
+        target = 'E';
+        seconds = rate_seconds_to(total_height, distance);
+    }
+
+    // Flow with one decimal place below 100 l/min
+    pos = format_fixed1(lcd_row, fill_rate, 5);
+    memcpy_P(pos, PSTR("L/m  "), 5);
+    pos += 5;
+    *pos++ = target;
+
+    if (seconds == RATE_NEVER)
+    {
+        memcpy_P(pos, PSTR("--:--"), 5);
+    }
+    else if (seconds >= 3600)
+    {
+        pos = format_uint(pos, seconds / 3600, 2, '0');
+        *pos++ = 'h';
+        format_uint(pos, (seconds / 60) % 60, 2, '0');
+    }
+    else
+    {
+        pos = format_uint(pos, seconds / 60, 2, '0');
+        *pos++ = ':';
+        format_uint(pos, seconds % 60, 2, '0');
+    }
+
+    lcd_buffer_show_row(1, lcd_row);
 }
 /**********************************************************************
  * Function: Resolves tank overflow and fill status
  * Purpose:  If tank is filled too much based on distance, function
  *           prepares LCD with OVERFLOW text and surprised smiley,
  *           otherwise tank is full and text FULL is prepared.
- * Input:    lcd_str    - string for water level status
- *           lcd_smiley - string for smiley :^)
+ * Input:    lcd_str    - 8 characters for water level status
+ *           lcd_smiley - 3 characters for smiley :^)
  * Returns:  none
  **********************************************************************/
 void resolve_full_water_level_or_overflow(char *lcd_str, char *lcd_smiley)
 {
     if (distance < max_level)
     {
-        strcpy(lcd_str, "OVERFLOW");
-        strcpy(lcd_smiley, ":^O");
+        memcpy_P(lcd_str, PSTR("OVERFLOW"), 8);
+        memcpy_P(lcd_smiley, PSTR(":^O"), 3);
     }
     else
     {
-        strcpy(lcd_str, "FULL    ");
-        strcpy(lcd_smiley, ":^)");
+        memcpy_P(lcd_str, PSTR("FULL    "), 8);
+        memcpy_P(lcd_smiley, PSTR(":^)"), 3);
     }
 
     char_num = 5;
 
     // Signal full level on LED if valve is not open
-    if (!pumpIsOn)
-        GPIO_write_high(&PORTB, LED_G);
+    if (!pump_is_running())
+        GPIO_PIN_HIGH(LED_G);
     if (!valveIsOpen)
-        GPIO_write_low(&PORTB, LED_R);
+        GPIO_PIN_LOW(LED_R);
 }
 /**********************************************************************
  * Function: Resolves LCD values for filled tank in norm
  * Purpose:  If tank is filled with at least 10% and less than 100%,
  *           function shows happy smiley and prepares LCD values.
- * Input:    lcd_str    - string for water level status
- *           lcd_smiley - string for smiley :^)
+ * Input:    lcd_str    - 8 characters for water level status
+ *           lcd_smiley - 3 characters for smiley :^)
  * Returns:  none
  **********************************************************************/
 void resolve_two_digit_water_level(char *lcd_str, char *lcd_smiley)
 {
-    itoa(volume, lcd_str, 10);
-    strcpy(lcd_smiley, ":^)");
-
-    lcd_show(6, 0, "%     ");
+    format_percent(lcd_str, volume, 8);
+    memcpy_P(lcd_smiley, PSTR(":^)"), 3);
 
     if (volume > 80)
         char_num = 5;
@@ -310,58 +713,56 @@ void resolve_two_digit_water_level(char *lcd_str, char *lcd_smiley)
     else
         char_num = 1;
 
-    if (!pumpIsOn)
-        GPIO_write_low(&PORTB, LED_G);
+    if (!pump_is_running())
+        GPIO_PIN_LOW(LED_G);
     if (!valveIsOpen)
-        GPIO_write_low(&PORTB, LED_R);
+        GPIO_PIN_LOW(LED_R);
 }
 /**********************************************************************
  * Function: Resolves LCD values for almost empty tank
  * Purpose:  If tank is almost empty, function shows user custom chars with
  *           stressed smiley face and EMPTY water tank char.
- * Input:    lcd_str    - string for water level status
- *           lcd_smiley - string for smiley :^)
+ * Input:    lcd_str    - 8 characters for water level status
+ *           lcd_smiley - 3 characters for smiley :^)
  * Returns:  none
  **********************************************************************/
 void resolve_single_digit_water_level(char *lcd_str, char *lcd_smiley)
 {
-    itoa(volume, lcd_str, 10);
-    strcpy(lcd_smiley, ":^I");
-
-    lcd_show(5, 0, "%      ");
+    format_percent(lcd_str, volume, 8);
+    memcpy_P(lcd_smiley, PSTR(":^I"), 3);
 
     char_num = 1;
 
-    if (!pumpIsOn)
-        GPIO_write_low(&PORTB, LED_G);
+    if (!pump_is_running())
+        GPIO_PIN_LOW(LED_G);
     if (!valveIsOpen)
-        GPIO_write_low(&PORTB, LED_R);
+        GPIO_PIN_LOW(LED_R);
 }
 /**********************************************************************
  * Function: Resolves LCD values for empty water tank 
  * Purpose:  If tank is empty, function shows user custom chars with
  *           sad smiley face and EMPTY text.
- * Input:    lcd_str    - string for water level status
- *           lcd_smiley - string for smiley :^)
+ * Input:    lcd_str    - 8 characters for water level status
+ *           lcd_smiley - 3 characters for smiley :^)
  * Returns:  none
  **********************************************************************/
 void resolve_empty(char *lcd_str, char *lcd_smiley)
 {
-    strcpy(lcd_str, "EMPTY   ");
-    strcpy(lcd_smiley, ":^(");
+    memcpy_P(lcd_str, PSTR("EMPTY   "), 8);
+    memcpy_P(lcd_smiley, PSTR(":^("), 3);
 
     char_num = 0;
 
-    if (!pumpIsOn)
-        GPIO_write_low(&PORTB, LED_G);
+    if (!pump_is_running())
+        GPIO_PIN_LOW(LED_G);
     if (!valveIsOpen)
-        GPIO_write_high(&PORTB, LED_R);
+        GPIO_PIN_HIGH(LED_R);
 }
 /**********************************************************************
  * Function: Resolves LCD values based on tank water percentage 
  * Purpose:  Prepares LCD values based on tank water level percentage.
- * Input:    lcd_str    - string for water level status
- *           lcd_smiley - string for smiley :^)
+ * Input:    lcd_str    - 8 characters for water level status
+ *           lcd_smiley - 3 characters for smiley :^)
  * Returns:  none
  **********************************************************************/
 void resolve_tank_fill_percentage(char *lcd_str, char *lcd_smiley)
@@ -384,52 +785,92 @@ void resolve_tank_fill_percentage(char *lcd_str, char *lcd_smiley)
  **********************************************************************/
 void check_valve_on_or_water_overflow()
 {
-    if (distance < max_level || GPIO_read(&PINC, SW_SERVO))
+    static uint8_t overflowing = 0;
+    static uint8_t predicted = 0;
+
+    // Level is unknown without sensor, only the switch moves the valve
+    if (health_get_faults() & (HEALTH_NO_ECHO | HEALTH_STUCK))
+    {
+        predicted = 0;
+        if (switch_is_on(GPIO_PIN_MASK(SW_SERVO)) && !valveIsOpen)
+            open_valve();
+        else if (!switch_is_on(GPIO_PIN_MASK(SW_SERVO)) && valveIsOpen)
+            close_valve();
+        return;
+    }
+
+    // Record each rise above max level once
+    if (distance < max_level && !overflowing)
+        log_event(EVENTLOG_OVERFLOW);
+    overflowing = distance < max_level;
+
+    // Water rising above full level fast enough to overflow soon opens
+    // valve early, it stays open until level is back at full
+    if (distance >= air_gap)
+        predicted = 0;
+    else if (rate_seconds_to(max_level, distance) <= VALVE_LEAD_S)
+        predicted = 1;
+
+    if (distance < max_level || predicted || switch_is_on(GPIO_PIN_MASK(SW_SERVO)))
     {
-        lcd_show(13, 1, "OPN");
         if (!valveIsOpen)
             open_valve();
     }
     else if (valveIsOpen)
     {
-        lcd_show(13, 1, "CLS");
         close_valve();
     }
 }
 /**********************************************************************
  * Function: Checks if pump is on and water level is OK 
- * Purpose:  Based on water level turns pump on or off.
+ * Purpose:  Based on water level turns pump on or off with
+ *           hysteresis and minimum run and rest times.
  * Input:    none
  * Returns:  none
  **********************************************************************/
 void check_pump_on_or_water_level_ok()
 {
-    if (distance > air_gap && GPIO_read(&PINC, SW_PUMP)) 
-    {
-        lcd_show(4, 1, "ON ");
+    uint8_t enabled = switch_is_on(GPIO_PIN_MASK(SW_PUMP));
+    uint32_t now = get_uptime();
 
-        pump_on();
-    }
-    else 
+    // Valve drain may outrun the pump, judge the pump only without it
+    log_faults(health_pump_check(pump_is_running() && !valveIsOpen, enabled, distance, now));
+
+    // Any fault stops the pump at once, overriding minimum run time
+    if (health_get_faults())
+        enabled = 0;
+
+    // Relay and LED timer change only on real transitions
+    switch (pump_update(distance, enabled, now))
     {
-        lcd_show(4, 1, "OFF");
+    case PUMP_START:
+        pump_on();
+        break;
+
+    case PUMP_STOP:
         pump_off();
+        break;
     }
 }
 /**********************************************************************
  * Function: Calculates measured distance from sensor 
- * Purpose:  Sensor tells us distance between water and sensor.
+ * Purpose:  Sensor tells us distance between water and sensor,
+ *           spurious echoes are filtered out.
  * Input:    none
  * Returns:  none
  **********************************************************************/
 void get_measured_distance()
 {
-    if ((distance = ultrasonic_get_distance()) > total_height)
+    raw_distance = ultrasonic_ticks_to_cm(level_sample.echo_ticks);
+    filter_add(raw_distance);
+
+    if ((distance = filter_get()) > total_height)
         distance = total_height;
 }
 /**********************************************************************
  * Function: Calculates water level from measured distance from sensor
- * Purpose:  Volume is needed to show fill percentage of tank
+ * Purpose:  Volume is needed to show fill percentage of tank, read
+ *           from table precomputed for the tank shape
  * Input:    none
  * Returns:  none
  **********************************************************************/
@@ -437,101 +878,384 @@ void calculate_water_volume()
 {
     get_measured_distance();
 
-    volume = 100 - ((distance - air_gap) * 100 / water_height);
+    volume = geometry_percent(distance);
+    litres = geometry_litres(distance);
 }
 /**********************************************************************
- * Function: Main function where the program execution begins
- * Purpose:  Update stopwatch value on LCD display when 8-bit 
- *           Timer/Counter2 overflows.
+ * Function: Calculates fill rate
+ * Purpose:  Convert level rate of the estimator to volume rate by
+ *           tank cross-section around current level.
+ * Input:    none
  * Returns:  none
  **********************************************************************/
-int main(void)
+void calculate_fill_rate()
 {
-    init_configurations();
+    uint16_t slice = RATE_SLICE_CM;
+    uint16_t top;
+    int32_t rate;
 
-    set_initial_lcd_values();
+    rate_update(distance, level_sample.time_ms);
 
-    set_timer_overflows();
+    // Band of RATE_SLICE_CM centered at current level, kept inside
+    // the tank where the table has slope
+    if (slice > water_height)
+        slice = water_height;
+    top = (distance > air_gap + slice / 2) ? distance - slice / 2 : air_gap;
+    if (top + slice > total_height)
+        top = total_height - slice;
 
-    // Enables interrupts by setting the global interrupt mask
-    sei();
-    
-    while (1)
-    {
-    }
+    // mm/min times litres/cm gives dl/min
+    rate = (int32_t)rate_get_mm_min() *
+           (geometry_litres(top) - geometry_litres(top + slice)) / slice;
 
-    return 0;
+    if (rate > INT16_MAX)
+        rate = INT16_MAX;
+    else if (rate < -INT16_MAX)
+        rate = -INT16_MAX;
+    fill_rate = rate;
 }
-/* Interrupt service routines ----------------------------------------*/
 /**********************************************************************
- * Function: External Interrupt 0
- * Purpose:  Register echo signal from sensor and calculate distance
- *           based on its length
+ * Function: Adapts measurement rate
+ * Purpose:  Ping less often while the level stays within a small band
+ *           and pump and valve are idle, return to full rate on the
+ *           first change.
+ * Input:    none
+ * Returns:  none
  **********************************************************************/
-ISR(INT0_vect)
+void adapt_ping_period()
 {
-    // State counter
-    static uint8_t echoIsHigh = 1;
-    // String for water level status
-    static char lcd_str[16];
-    // String for smiley :^)
-    static char lcd_smiley[8];
+    // Distance at the start of the stable band
+    static uint16_t reference = 0;
+    static uint8_t stable_pings = 0;
+    uint16_t delta = (distance > reference) ? distance - reference : reference - distance;
+    uint16_t period = ping_period;
 
-    if (echoIsHigh)
+    if (pump_is_running() || valveIsOpen || delta > STABLE_DELTA_CM)
     {
-        ultrasonic_start_measuring();
-
-        echoIsHigh = 0;
+        reference = distance;
+        stable_pings = 0;
+        period = PING_PERIOD_FAST;
+    }
+    else if (stable_pings < STABLE_PINGS)
+    {
+        ++stable_pings;
     }
     else
     {
-        calculate_water_volume();
+        period = PING_PERIOD_SLOW;
+    }
 
-        resolve_tank_fill_percentage(lcd_str, lcd_smiley);
+    // Restart ping timer only on change, restarting resets its phase
+    if (period != ping_period)
+    {
+        ping_period = period;
+        timer_every(&ping_timer, ping_period, trigger_ping);
+    }
+}
+/**********************************************************************
+ * Function: Record level history
+ * Purpose:  Log measured distance every LEVEL_HISTORY_S seconds.
+ * Input:    none
+ * Returns:  none
+ **********************************************************************/
+void record_level_history()
+{
+    static uint32_t next_sample = 0;
+    uint32_t now = get_uptime();
 
-        check_valve_on_or_water_overflow();
+    if (now >= next_sample)
+    {
+        log_event(EVENTLOG_LEVEL);
+        next_sample = now + LEVEL_HISTORY_S;
+    }
+}
+/**********************************************************************
+ * Function: Measurement task
+ * Purpose:  Convert last echo to water volume and schedule control and
+ *           display update.
+ * Input:    none
+ * Returns:  none
+ **********************************************************************/
+void measure_task()
+{
+    // Copy is consistent even if the next echo completes meanwhile
+    ultrasonic_get_sample(SENSOR_LEVEL, &level_sample);
 
-        check_pump_on_or_water_level_ok();
+    // Timeout of a later ping replaced the echo, missed task counts it
+    if (level_sample.status != ULTRASONIC_ECHO)
+        return;
 
-        show_final_lcd_values(lcd_str, lcd_smiley, char_num);
+    log_faults(health_echo_received(level_sample.echo_ticks));
 
-        echoIsHigh = 1;
-    }
+#if TEMPERATURE_COMPENSATION
+    // Conversion started by previous echo is long finished
+    if (temperature_update())
+        ultrasonic_set_temperature(temperature_get());
+#endif
+
+    calculate_water_volume();
+
+    calculate_fill_rate();
+
+    adapt_ping_period();
+
+    record_level_history();
+
+    pending_tasks |= TASK_CONTROL | TASK_DISPLAY | TASK_TELEMETRY;
+}
+/**********************************************************************
+ * Function: Missed echo task
+ * Purpose:  Count ping without echo, lost sensor puts control into
+ *           safe state.
+ * Input:    none
+ * Returns:  none
+ **********************************************************************/
+void missed_task()
+{
+    log_faults(health_echo_missed());
+
+    pending_tasks |= TASK_CONTROL | TASK_DISPLAY;
+}
+/**********************************************************************
+ * Function: Control task
+ * Purpose:  Drive valve and pump based on last measured water level.
+ * Input:    none
+ * Returns:  none
+ **********************************************************************/
+void control_task()
+{
+    check_valve_on_or_water_overflow();
+
+    check_pump_on_or_water_level_ok();
+}
+/**********************************************************************
+ * Function: Display task
+ * Purpose:  Show water level status on LCD.
+ * Input:    none
+ * Returns:  none
+ **********************************************************************/
+void display_task()
+{
+    // Whole first row, e.g. "LVL:65%     :^)" and tank icon
+    char lcd_row[LCD_DISP_LENGTH];
+
+    memcpy_P(lcd_row, PSTR("LVL:"), 4);
+    resolve_tank_fill_percentage(&lcd_row[4], &lcd_row[12]);
+    lcd_row[15] = char_num;
+
+    lcd_buffer_show_row(0, lcd_row);
+
+    // Second row alternates between outputs and fill prediction,
+    // fault replaces both
+    if (health_get_code())
+        show_fault();
+    else if ((get_uptime() / ROW_PAGE_S) & 1)
+        show_fill_rate();
+    else
+        show_pump_and_valve();
+
+    // Send only cells which changed since last update
+    lcd_buffer_flush();
 }
 /**********************************************************************
- * Function: Timer/Counter0 overflow interrupt
- * Purpose:  Trigger ultrasonic sensor every ~40 ms
+ * Function: Telemetry task
+ * Purpose:  Report last measurement and resulting pump and valve
+ *           state, queued frame is sent by USART interrupt.
+ * Input:    none
+ * Returns:  none
  **********************************************************************/
-ISR(TIMER0_OVF_vect)
+void telemetry_task()
 {
-    static uint8_t timerCounter = 0;
-    ++timerCounter;
+#if TELEMETRY
+    telemetry_sample_t sample;
 
-    if (timerCounter == 9)
+    sample.echo_ticks = level_sample.echo_ticks;
+    sample.raw_cm = raw_distance;
+    sample.distance_cm = distance;
+    sample.litres = litres;
+    sample.percent = volume;
+    sample.flags = (pump_is_running() ? TELEMETRY_PUMP_ON : 0) |
+                   (valveIsOpen ? TELEMETRY_VALVE_OPEN : 0) |
+                   (health_get_faults() << TELEMETRY_FAULT_SHIFT);
+#if TEMPERATURE_COMPENSATION
+    sample.temperature = temperature_get();
+#else
+    sample.temperature = 0;
+#endif
+    sample.isr_latency_max = latency_get_max();
+    sample.overruns = queue_get_overruns();
+
+    telemetry_send(&sample);
+#endif
+}
+/**********************************************************************
+ * Function: Dispatch events
+ * Purpose:  Take all events posted by interrupts and mark tasks which
+ *           have to handle them.
+ * Input:    none
+ * Returns:  none
+ **********************************************************************/
+void dispatch_events()
+{
+    uint8_t event;
+
+    while (queue_get(&event))
     {
-        ultrasonic_trigger(&PORTD, TRIG);
+        if (event == EVENT_ECHO_RECEIVED)
+            pending_tasks |= TASK_MEASURE;
+        else if (event == EVENT_ECHO_TIMEOUT)
+            pending_tasks |= TASK_MISSED;
+        else if (event == EVENT_SWITCH)
+            pending_tasks |= TASK_CONTROL | TASK_DISPLAY;
+    }
+}
+/**********************************************************************
+ * Function: Run pending tasks
+ * Purpose:  Cooperative scheduler, runs every pending task once in
+ *           order of the task table.
+ * Input:    none
+ * Returns:  none
+ **********************************************************************/
+void run_pending_tasks()
+{
+    // Task table in order of priority
+    static const task_t tasks[] = {
+        {TASK_MEASURE, measure_task},
+        {TASK_MISSED, missed_task},
+        {TASK_CONTROL, control_task},
+        {TASK_DISPLAY, display_task},
+        {TASK_TELEMETRY, telemetry_task},
+    };
 
-        timerCounter = 0;
+    for (uint8_t i = 0; i < sizeof(tasks) / sizeof(tasks[0]); i++)
+    {
+        if (pending_tasks & tasks[i].mask)
+        {
+            pending_tasks &= ~tasks[i].mask;
+            tasks[i].run();
+        }
     }
 }
 /**********************************************************************
- * Function: Timer/Counter2 compare match interrupt
- * Purpose:  Toggle LED(s) every ~500ms
+ * Function: Check reset cause
+ * Purpose:  Watchdog stays enabled with shortest timeout after it
+ *           reset the MCU, stop it before the slow initialization and
+ *           remember the cause.
+ * Input:    none
+ * Returns:  none
  **********************************************************************/
-ISR(TIMER2_OVF_vect)
+void check_reset_cause()
 {
-    static uint8_t number_of_overflows = 0;
+    if (MCUSR & (1<<WDRF))
+        reset_by_watchdog = 1;
 
-    ++number_of_overflows;
+    MCUSR = 0;
+    wdt_disable();
+}
+/**********************************************************************
+ * Function: Main function where the program execution begins
+ * Purpose:  Initialize peripherals and run tasks posted by interrupt
+ *           service routines, sleep when there is nothing to do.
+ * Returns:  none
+ **********************************************************************/
+int main(void)
+{
+    check_reset_cause();
+
+    init_configurations();
+
+    if (reset_by_watchdog)
+        log_event(EVENTLOG_WATCHDOG);
+
+    set_initial_lcd_values();
 
-    if (number_of_overflows >= 31)
+    start_timers();
+
+    // System tick wakes main loop every 1 ms, so only a hang starves
+    // the watchdog
+    wdt_enable(WATCHDOG_TIMEOUT);
+
+    // Enables interrupts by setting the global interrupt mask
+    sei();
+    
+    while (1)
     {
-        if (valveIsOpen)
-            GPIO_toggle(&PORTB, LED_R);
+        wdt_reset();
+
+        dispatch_events();
 
-        if (pumpIsOn)
-            GPIO_toggle(&PORTB, LED_G);
+        run_pending_tasks();
 
-        number_of_overflows = 0;
+        cli();
+        if (!pending_tasks && queue_is_empty())
+        {
+            // Instruction after SEI is executed before any pending
+            // interrupt, so an event posted after the check wakes the CPU
+            sleep_enable();
+            sei();
+            sleep_cpu();
+            sleep_disable();
+        }
+        sei();
     }
+
+    return 0;
+}
+/* Interrupt service routines ----------------------------------------*/
+/**********************************************************************
+ * Function: Echo edge
+ * Purpose:  Common body of pin change interrupts, timestamp echo edges
+ *           and notify main loop when the level echo is complete.
+ * Input:    pin_reg - Pin Register of the interrupting port
+ * Returns:  none
+ **********************************************************************/
+static inline void echo_edge(volatile uint8_t *pin_reg)
+{
+    if (ultrasonic_echo_changed(pin_reg, TCNT1) & (1<<SENSOR_LEVEL))
+        queue_post(EVENT_ECHO_RECEIVED);
+}
+/**********************************************************************
+ * Function: Pin change interrupts 0 to 2
+ * Purpose:  Echo inputs of ultrasonic sensors on port B, C and D,
+ *           manual switches on port C
+ **********************************************************************/
+ISR(PCINT0_vect)
+{
+    echo_edge(&PINB);
+}
+
+ISR(PCINT1_vect)
+{
+    echo_edge(&PINC);
+
+    // Manual switches share the port, sample them until they settle
+    if (!timer_is_active(&debounce_timer))
+        timer_every(&debounce_timer, DEBOUNCE_PERIOD, sample_switches);
+}
+
+ISR(PCINT2_vect)
+{
+    echo_edge(&PIND);
+}
+/**********************************************************************
+ * Function: Timer/Counter2 compare match interrupt
+ * Purpose:  End of 10 us ultrasonic trigger pulse
+ **********************************************************************/
+ISR(TIMER2_COMPA_vect)
+{
+    // Counter runs on past the compare value with TIM1 tick rate
+    latency_record((uint8_t)(TCNT2 - OCR2A));
+
+    ultrasonic_pulse_end();
+}
+/**********************************************************************
+ * Function: Timer/Counter0 compare match interrupt
+ * Purpose:  System tick, run software timers every 1 ms
+ **********************************************************************/
+ISR(TIMER0_COMPA_vect)
+{
+    // Compare match cleared the counter, it counts 4 us ticks since
+    latency_record(TCNT0 * TICK_TIM1_TICKS);
+
+    tick_handle();
 }
@@ -0,0 +1,84 @@
+/***********************************************************************
+ *
+ * Pump relay state machine for AVR-GCC.
+ * ATmega328P (Arduino Uno), 16 MHz, AVR 8-bit Toolchain 3.6.2
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/* Includes ----------------------------------------------------------*/
+#include "pump.h"
+
+/* Variables ---------------------------------------------------------*/
+// Thresholds and times
+static pump_config_t pump;
+// Relay is on
+static uint8_t running;
+// Time of the last start and stop in seconds
+static uint32_t started_at;
+static uint32_t stopped_at;
+
+/* Function definitions ----------------------------------------------*/
+/**********************************************************************
+ * Function: pump_init()
+ * Purpose:  Set thresholds, also at run time. A running pump keeps
+ *           running, a stopped one may start at once.
+ * Input:    config - Thresholds and times
+ *           now_s  - Current time in seconds
+ * Returns:  none
+ **********************************************************************/
+void pump_init(const pump_config_t *config, uint32_t now_s)
+{
+    pump = *config;
+
+    if (!running) {
+        // Pretend last cycle is long over, times compare modulo 2^32
+        started_at = now_s - pump.min_cycle_s;
+        stopped_at = now_s - pump.min_off_s;
+    }
+}
+
+/**********************************************************************
+ * Function: pump_update()
+ * Purpose:  Advance state machine by one measurement.
+ * Input:    distance - Filtered distance in cm
+ *           enabled  - Pump switch is on
+ *           now_s    - Current time in seconds
+ * Returns:  PUMP_NONE, PUMP_START or PUMP_STOP
+ **********************************************************************/
+uint8_t pump_update(uint16_t distance, uint8_t enabled, uint32_t now_s)
+{
+    if (running) {
+        // Switch and overflow override minimum run time
+        if (!enabled || distance < pump.limit_cm ||
+            (distance <= pump.stop_cm && now_s - started_at >= pump.min_on_s)) {
+            running = 0;
+            stopped_at = now_s;
+            return PUMP_STOP;
+        }
+    }
+    else if (enabled && distance > pump.start_cm &&
+             now_s - stopped_at >= pump.min_off_s &&
+             now_s - started_at >= pump.min_cycle_s) {
+        running = 1;
+        started_at = now_s;
+        return PUMP_START;
+    }
+
+    return PUMP_NONE;
+}
+
+/**********************************************************************
+ * Function: pump_is_running()
+ * Purpose:  Current state of the relay.
+ * Input:    none
+ * Returns:  1 if pump runs, 0 otherwise
+ **********************************************************************/
+uint8_t pump_is_running()
+{
+    return running;
+}
@@ -0,0 +1,88 @@
+#ifndef PUMP_H_
+#define PUMP_H_
+
+/***********************************************************************
+ *
+ * Pump relay state machine for AVR-GCC.
+ * ATmega328P (Arduino Uno), 16 MHz, AVR 8-bit Toolchain 3.6.2
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/**
+ * @file
+ * @defgroup pump Pump relay state machine <pump.h>
+ * @code #include "pump.h" @endcode
+ *
+ * @brief Decides when the pump relay switches, the caller drives it.
+ *
+ * The pump starts when the water surface falls below the lower band,
+ * i.e. sensor distance grows above start_cm, and stops when distance
+ * falls to stop_cm. Between both the state is kept, so noise around
+ * one threshold cannot toggle the relay. Relay is kept on for at least
+ * min_on_s and off for at least min_off_s, and two starts are at
+ * least min_cycle_s apart. Switching pump off by the switch and
+ * reaching limit_cm stop it at once regardless of minimum run time.
+ *
+ * pump_update() returns an action only on a real transition, so the
+ * caller touches the relay pin and LED timer only then.
+ *
+ * @{
+ */
+
+/* Includes ----------------------------------------------------------*/
+#include <avr/io.h>         // AVR device-specific IO definitions
+
+/* Defines -----------------------------------------------------------*/
+#define PUMP_NONE  0        // Keep relay as it is
+#define PUMP_START 1        // Switch relay on
+#define PUMP_STOP  2        // Switch relay off
+
+/* Types -------------------------------------------------------------*/
+/** @brief Thresholds in cm of sensor distance, times in seconds */
+typedef struct {
+    uint16_t start_cm;      // Start when distance grows above
+    uint16_t stop_cm;       // Stop when distance falls to
+    uint16_t limit_cm;      // Stop at once when distance falls below
+    uint16_t min_on_s;      // Minimum run time
+    uint16_t min_off_s;     // Minimum rest time
+    uint16_t min_cycle_s;   // Minimum time between two starts
+} pump_config_t;
+
+/* Function prototypes -----------------------------------------------*/
+/**
+ * @name Functions
+ */
+
+/**
+ * @brief  Set thresholds, also at run time. A running pump keeps
+ *         running, a stopped one may start at once.
+ * @param  config Thresholds and times, copied
+ * @param  now_s  Current time in seconds
+ * @return none
+ */
+void pump_init(const pump_config_t *config, uint32_t now_s);
+
+/**
+ * @brief  Advance state machine by one measurement.
+ * @param  distance Filtered distance in cm
+ * @param  enabled  Pump switch is on
+ * @param  now_s    Current time in seconds
+ * @return PUMP_NONE, PUMP_START or PUMP_STOP
+ */
+uint8_t pump_update(uint16_t distance, uint8_t enabled, uint32_t now_s);
+
+/**
+ * @brief  Current state of the relay.
+ * @param  none
+ * @return 1 if pump runs, 0 otherwise
+ */
+uint8_t pump_is_running();
+
+/** @} */
+
+#endif /* PUMP_H_ */
@@ -0,0 +1,90 @@
+/***********************************************************************
+ *
+ * Lock-free event queue for AVR-GCC.
+ * ATmega328P (Arduino Uno), 16 MHz, AVR 8-bit Toolchain 3.6.2
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/* Includes ----------------------------------------------------------*/
+#include "queue.h"
+
+/* Variables ---------------------------------------------------------*/
+// Event slots
+static volatile uint8_t events[QUEUE_SIZE];
+// Next slot to write, owned by producer
+static volatile uint8_t head;
+// Next slot to read, owned by consumer
+static volatile uint8_t tail;
+// Events lost because consumer was too slow
+static volatile uint8_t overruns;
+
+/* Function definitions ----------------------------------------------*/
+/**********************************************************************
+ * Function: queue_post()
+ * Purpose:  Store event to the queue from interrupt context.
+ * Input:    event - Event code
+ * Returns:  1 if event was stored, 0 if queue is full
+ **********************************************************************/
+uint8_t queue_post(uint8_t event)
+{
+    uint8_t next = (head + 1) & QUEUE_MASK;
+
+    if (next == tail) {
+        if (overruns != 0xFF)
+            ++overruns;
+        return 0;
+    }
+
+    events[head] = event;
+    // Publish slot only after its content is written
+    head = next;
+
+    return 1;
+}
+
+/**********************************************************************
+ * Function: queue_get()
+ * Purpose:  Take the oldest event from the queue in main loop.
+ * Input:    event - Pointer where to store event code
+ * Returns:  1 if event was taken, 0 if queue is empty
+ **********************************************************************/
+uint8_t queue_get(uint8_t *event)
+{
+    uint8_t current = tail;
+
+    if (current == head)
+        return 0;
+
+    *event = events[current];
+    // Release slot only after its content is read
+    tail = (current + 1) & QUEUE_MASK;
+
+    return 1;
+}
+
+/**********************************************************************
+ * Function: queue_is_empty()
+ * Purpose:  Check whether any event is waiting.
+ * Input:    none
+ * Returns:  1 if queue is empty, 0 otherwise
+ **********************************************************************/
+uint8_t queue_is_empty()
+{
+    return head == tail;
+}
+
+/**********************************************************************
+ * Function: queue_get_overruns()
+ * Purpose:  Number of events dropped because the queue was full.
+ * Input:    none
+ * Returns:  Dropped event count
+ **********************************************************************/
+uint8_t queue_get_overruns()
+{
+    return overruns;
+}
@@ -0,0 +1,74 @@
+#ifndef QUEUE_H_
+#define QUEUE_H_
+
+/***********************************************************************
+ *
+ * Lock-free event queue for AVR-GCC.
+ * ATmega328P (Arduino Uno), 16 MHz, AVR 8-bit Toolchain 3.6.2
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/**
+ * @file
+ * @defgroup queue Lock-free event queue <queue.h>
+ * @code #include "queue.h" @endcode
+ *
+ * @brief Single-producer single-consumer event queue.
+ *
+ * Interrupt service routines post events and the main loop consumes
+ * them. Interrupts do not nest on AVR, so all ISRs together act as a
+ * single producer. Head index is written only by the producer and tail
+ * index only by the consumer, both are 8-bit and therefore accessed
+ * atomically without disabling interrupts.
+ *
+ * @{
+ */
+
+/* Includes ----------------------------------------------------------*/
+#include <avr/io.h>         // AVR device-specific IO definitions
+
+/* Defines -----------------------------------------------------------*/
+#define QUEUE_SIZE  16      // Number of slots, must be power of two
+#define QUEUE_MASK  (QUEUE_SIZE - 1)
+
+/* Function prototypes -----------------------------------------------*/
+/**
+ * @name Functions
+ */
+
+/**
+ * @brief  Post event to the queue. Call from interrupt context only.
+ * @param  event Event code
+ * @return 1 if event was stored, 0 if queue is full
+ */
+uint8_t queue_post(uint8_t event);
+
+/**
+ * @brief  Take the oldest event from the queue. Call from main loop.
+ * @param  event Pointer where to store event code
+ * @return 1 if event was taken, 0 if queue is empty
+ */
+uint8_t queue_get(uint8_t *event);
+
+/**
+ * @brief  Check whether any event is waiting.
+ * @param  none
+ * @return 1 if queue is empty, 0 otherwise
+ */
+uint8_t queue_is_empty();
+
+/**
+ * @brief  Number of events dropped because the queue was full.
+ * @param  none
+ * @return Dropped event count
+ */
+uint8_t queue_get_overruns();
+
+/** @} */
+
+#endif /* QUEUE_H_ */
@@ -0,0 +1,178 @@
+/***********************************************************************
+ *
+ * Streaming level rate estimator for AVR-GCC.
+ * ATmega328P (Arduino Uno), 16 MHz, AVR 8-bit Toolchain 3.6.2
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/* Includes ----------------------------------------------------------*/
+#include "rate.h"
+
+/* Defines -----------------------------------------------------------*/
+// Largest numerator which can be multiplied by the unit conversion
+#define RATE_SCALE     9375L   // 10 mm/cm * 3750 steps/min / 4
+#define RATE_NUM_MAX   (INT32_MAX / RATE_SCALE)
+
+/* Variables ---------------------------------------------------------*/
+// Samples taken, saturates at RATE_WARMUP
+static uint8_t samples;
+// Time of the last sample in ms, remainder of time step is kept
+static uint32_t last_ms;
+// Distance of the last sample in cm
+static uint16_t last_distance;
+// Weighted mean age of samples in time steps
+static int32_t mean_age;
+// Weighted mean distance in 1/256 cm
+static int32_t mean_distance;
+// Weighted variance of time and covariance of time and distance
+static int32_t var_time;
+static int32_t cov_time_distance;
+// Last result in mm/min
+static int16_t rate;
+
+/* Function definitions ----------------------------------------------*/
+/**********************************************************************
+ * Function: rate_solve()
+ * Purpose:  Convert slope of the regression to level rate.
+ * Input:    none
+ * Returns:  Rate in mm/min, rising water is positive
+ **********************************************************************/
+static int16_t rate_solve()
+{
+    int32_t num = cov_time_distance;
+    int32_t den = var_time;
+    int32_t mm_min;
+
+    // Scale both down until conversion cannot overflow
+    while (num > RATE_NUM_MAX || num < -RATE_NUM_MAX) {
+        num >>= 1;
+        den >>= 1;
+    }
+    if (den <= 0)
+        return 0;
+
+    // Slope is 1/256 cm per step, 4 / 256 of the scale is left,
+    // distance falls as water rises
+    mm_min = -(num * RATE_SCALE / den) / 64;
+
+    if (mm_min > INT16_MAX)
+        return INT16_MAX;
+    if (mm_min < -INT16_MAX)
+        return -INT16_MAX;
+
+    return (int16_t)mm_min;
+}
+
+/**********************************************************************
+ * Function: rate_update()
+ * Purpose:  Add filtered distance to the weighted moments once per
+ *           RATE_PERIOD.
+ * Input:    distance - Filtered distance in cm
+ *           now_ms   - Time of the sample in ms
+ * Returns:  none
+ **********************************************************************/
+void rate_update(uint16_t distance, uint32_t now_ms)
+{
+    int32_t y = (int32_t)distance << 8;
+    uint16_t step = (distance > last_distance) ? distance - last_distance : last_distance - distance;
+    int32_t dt, dx, dy;
+
+    if (samples && now_ms - last_ms < RATE_PERIOD)
+        return;
+
+    last_distance = distance;
+
+    // Step of the filter output is not a flow
+    if (!samples || now_ms - last_ms > RATE_MAX_GAP || step > RATE_MAX_STEP) {
+        samples = 1;
+        last_ms = now_ms;
+        mean_age = 0;
+        mean_distance = y;
+        var_time = 0;
+        cov_time_distance = 0;
+        rate = 0;
+        return;
+    }
+
+    dt = (now_ms - last_ms) / RATE_TIME_UNIT;
+    last_ms += dt * RATE_TIME_UNIT;
+
+    // Time origin moves to the new sample, so centered moments stay
+    // and only the mean age grows
+    mean_age += dt;
+    dx = mean_age;
+    dy = y - mean_distance;
+
+    mean_age -= mean_age >> RATE_SHIFT;
+    mean_distance += dy >> RATE_SHIFT;
+    var_time += (dx * dx) >> RATE_SHIFT;
+    var_time -= var_time >> RATE_SHIFT;
+    cov_time_distance += (dx * dy) >> RATE_SHIFT;
+    cov_time_distance -= cov_time_distance >> RATE_SHIFT;
+
+    if (samples < RATE_WARMUP)
+        ++samples;
+    else
+        rate = rate_solve();
+}
+
+/**********************************************************************
+ * Function: rate_reset()
+ * Purpose:  Forget history, next sample starts a new estimate.
+ * Input:    none
+ * Returns:  none
+ **********************************************************************/
+void rate_reset()
+{
+    samples = 0;
+    rate = 0;
+}
+
+/**********************************************************************
+ * Function: rate_get_mm_min()
+ * Purpose:  Level change per minute.
+ * Input:    none
+ * Returns:  Rate in mm/min, rising water is positive
+ **********************************************************************/
+int16_t rate_get_mm_min()
+{
+    return rate;
+}
+
+/**********************************************************************
+ * Function: rate_seconds_to()
+ * Purpose:  Predicted time until water surface reaches a distance.
+ * Input:    target   - Distance of target level in cm
+ *           distance - Current distance in cm
+ * Returns:  Time in s, RATE_NEVER if level moves away or stands still
+ **********************************************************************/
+uint16_t rate_seconds_to(uint16_t target, uint16_t distance)
+{
+    uint32_t mm;
+    uint32_t seconds;
+    uint16_t speed;
+
+    if (target < distance && rate > 0) {
+        mm = (uint32_t)(distance - target) * 10;
+        speed = rate;
+    }
+    else if (target > distance && rate < 0) {
+        mm = (uint32_t)(target - distance) * 10;
+        speed = -rate;
+    }
+    else if (target == distance) {
+        return 0;
+    }
+    else {
+        return RATE_NEVER;
+    }
+
+    seconds = mm * 60 / speed;
+
+    return (seconds < RATE_NEVER) ? seconds : RATE_NEVER - 1;
+}
@@ -0,0 +1,96 @@
+#ifndef RATE_H_
+#define RATE_H_
+
+/***********************************************************************
+ *
+ * Streaming level rate estimator for AVR-GCC.
+ * ATmega328P (Arduino Uno), 16 MHz, AVR 8-bit Toolchain 3.6.2
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/**
+ * @file
+ * @defgroup rate Level rate estimator <rate.h>
+ * @code #include "rate.h" @endcode
+ *
+ * @brief Slope of filtered distance over time by weighted regression.
+ *
+ * Every sample updates exponentially weighted mean of sample age and
+ * distance and their centered second moments with weight
+ * 1 / 2^RATE_SHIFT, all in 32-bit fixed point. The slope is the ratio
+ * of covariance and variance of time, so unevenly spaced samples of
+ * the adaptive ping rate are handled and no history is stored. Time
+ * counts in RATE_TIME_UNIT ms, distance in 1/256 cm.
+ *
+ * Distance comes in 1 cm steps, so a slow flow needs a window of many
+ * seconds. Only one sample per RATE_PERIOD is taken, which makes the
+ * window length independent of the ping rate.
+ *
+ * A gap longer than RATE_MAX_GAP, which keeps the moments inside
+ * 32 bits, or a jump of more than RATE_MAX_STEP between two samples
+ * restarts the estimator.
+ * Switching pump or valve changes the slope at once, the caller
+ * restarts the estimator by rate_reset() instead of waiting for old
+ * samples to fade.
+ *
+ * @{
+ */
+
+/* Includes ----------------------------------------------------------*/
+#include <avr/io.h>         // AVR device-specific IO definitions
+
+/* Defines -----------------------------------------------------------*/
+#ifndef RATE_SHIFT
+#define RATE_SHIFT     5       // Weight 1/32, about 32 s window
+#endif
+#define RATE_PERIOD    1000    // ms between samples taken
+#define RATE_TIME_UNIT 16      // ms per time step
+#define RATE_MAX_GAP   2000    // ms between samples before restart
+#define RATE_MAX_STEP  64      // cm between two samples before restart
+#define RATE_WARMUP    8       // Samples before rate is reported
+#define RATE_NEVER     0xFFFF  // Level does not move towards target
+
+/* Function prototypes -----------------------------------------------*/
+/**
+ * @name Functions
+ */
+
+/**
+ * @brief  Add filtered distance, O(1), ignored until RATE_PERIOD
+ *         passed since the last sample.
+ * @param  distance Filtered distance in cm
+ * @param  now_ms   Time of the sample in ms
+ * @return none
+ */
+void rate_update(uint16_t distance, uint32_t now_ms);
+
+/**
+ * @brief  Forget history, call when inflow or outflow switches.
+ * @param  none
+ * @return none
+ */
+void rate_reset();
+
+/**
+ * @brief  Level change per minute, rising water is positive.
+ * @param  none
+ * @return Rate in mm/min, 0 until RATE_WARMUP samples are in
+ */
+int16_t rate_get_mm_min();
+
+/**
+ * @brief  Predicted time until water surface reaches a distance.
+ * @param  target   Distance of target level in cm
+ * @param  distance Current distance in cm
+ * @return Time in s, RATE_NEVER if level moves away or stands still
+ */
+uint16_t rate_seconds_to(uint16_t target, uint16_t distance);
+
+/** @} */
+
+#endif /* RATE_H_ */
@@ -0,0 +1,126 @@
+/***********************************************************************
+ * 
+ * SG90 servo motor library for AVR-GCC.
+ * ATmega328P (Arduino Uno), 16 MHz, AVR 8-bit Toolchain 3.6.2
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/* Includes ----------------------------------------------------------*/
+#include <util/atomic.h>    // Atomically and Non-Atomically Executed Code Blocks
+#include "latency.h"
+#include "servo.h"
+
+/* Variables ---------------------------------------------------------*/
+// Port Register of the servo signal pin
+static volatile uint8_t *servo_port;
+// Bit mask of the servo signal pin
+static uint8_t servo_mask;
+// Requested pulse width in TIM1 ticks
+static volatile uint16_t pulse_ticks = SERVO_MIN_US * SERVO_TICKS_PER_US;
+
+/* Function definitions ----------------------------------------------*/
+/**********************************************************************
+ * Function: servo_init()
+ * Purpose:  Configure pin and Timer/Counter1 Output Compare B unit.
+ * Input:    reg_name - Address of Data Direction Register, such as &DDRB
+ *           pin_num  - Servo signal pin designation in the interval 
+ *                      0 to 7
+ * Returns:  none
+ **********************************************************************/
+void servo_init(volatile uint8_t *reg_name, uint8_t pin_num)
+{
+    servo_mask = (1<<pin_num);
+
+    // Configure servo pin Data Direction Register as output
+    *reg_name |= servo_mask;
+    // Move pointer to address of Port Register
+    servo_port = ++reg_name;
+    // Drive port pin low
+    *servo_port &= ~servo_mask;
+
+    // Timer/Counter1 is normally started by ultrasonic_init()
+    if (!(TCCR1B & ((1<<CS12) | (1<<CS11) | (1<<CS10)))) {
+        TCCR1A = 0;
+        TCCR1B = (1<<CS11);
+    }
+
+    // First rising edge one period from now
+    OCR1B = TCNT1 + SERVO_PERIOD_US * SERVO_TICKS_PER_US;
+    // Clear pending flag and enable Output Compare B Match interrupt
+    TIFR1 = (1<<OCF1B);
+    TIMSK1 |= (1<<OCIE1B);
+}
+
+/**********************************************************************
+ * Function: servo_set_us()
+ * Purpose:  Set pulse width of the 50 Hz pulse train.
+ * Input:    us - Pulse width in microseconds
+ * Returns:  none
+ **********************************************************************/
+void servo_set_us(uint16_t us)
+{
+    if (us < SERVO_MIN_US)
+        us = SERVO_MIN_US;
+    else if (us > SERVO_MAX_US)
+        us = SERVO_MAX_US;
+
+    // 16-bit value is read by compare interrupt, write it in one piece
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        pulse_ticks = us * SERVO_TICKS_PER_US;
+    }
+}
+
+/**********************************************************************
+ * Function: servo_set_angle()
+ * Purpose:  Set servo angle.
+ * Input:    angle - Angle in degrees in the interval 0 to 180
+ * Returns:  none
+ **********************************************************************/
+void servo_set_angle(uint8_t angle)
+{
+    if (angle > 180)
+        angle = 180;
+
+    servo_set_us(SERVO_MIN_US + ((angle * SERVO_US_PER_DEG_Q8) >> 8));
+}
+
+/* Interrupt service routines ----------------------------------------*/
+/**********************************************************************
+ * Function: Timer/Counter1 compare match B interrupt
+ * Purpose:  Generate edges of the servo pulse train, next compare
+ *           match is scheduled relative to the current one
+ **********************************************************************/
+ISR(TIMER1_COMPB_vect)
+{
+    // Pulse width latched at the rising edge
+    static uint16_t current_ticks;
+    // Edge is late by the ticks counted past the compare value
+    uint16_t late = TCNT1 - OCR1B;
+
+    if (*servo_port & servo_mask) {
+        // End of pulse, wait for the rest of the period
+        *servo_port &= ~servo_mask;
+        OCR1B += SERVO_PERIOD_US * SERVO_TICKS_PER_US - current_ticks;
+    }
+    else {
+        // Start of pulse, width is timed from the compare match so
+        // interrupt latency does not stretch it
+        *servo_port |= servo_mask;
+        current_ticks = pulse_ticks;
+
+        // First match after start-up is served once sei() runs, longer
+        // after it than any pulse, the train restarts from the edge
+        if (late >= current_ticks) {
+            OCR1B += late;
+            late = 0;
+        }
+        OCR1B += current_ticks;
+    }
+
+    latency_record(late);
+}
@@ -0,0 +1,74 @@
+#ifndef SERVO_H_
+#define SERVO_H_
+
+/***********************************************************************
+ * 
+ * SG90 servo motor library for AVR-GCC.
+ * ATmega328P (Arduino Uno), 16 MHz, AVR 8-bit Toolchain 3.6.2
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/**
+ * @file 
+ * @defgroup servo SG90 servo motor library <servo.h>
+ * @code #include "servo.h" @endcode
+ *
+ * @brief SG90 servo motor library for AVR-GCC.
+ *
+ * Continuous 50 Hz pulse train is generated on any GPIO pin by
+ * Timer/Counter1 Output Compare B interrupt. Timer/Counter1 is shared
+ * with ultrasonic sensor library and must run freely with prescaler 
+ * N=8, so each edge is scheduled by adding the pulse or gap length 
+ * to OCR1B. CPU is free for the whole pulse.
+ *
+ * @{
+ */
+
+/* Defines -----------------------------------------------------------*/
+#define SERVO_PERIOD_US    20000 // Pulse period 20 ms, i.e. 50 Hz
+#define SERVO_MIN_US       1000  // Pulse width for 0 degrees
+#define SERVO_MAX_US       2000  // Pulse width for 180 degrees
+#define SERVO_TICKS_PER_US 2     // TIM1 with prescaler N=8 at 16 MHz
+// Pulse width increment per degree in Q8 fixed point
+#define SERVO_US_PER_DEG_Q8 (((SERVO_MAX_US - SERVO_MIN_US) * 256UL) / 180)
+
+/* Includes ----------------------------------------------------------*/
+#include <avr/interrupt.h>  // Interrupts standard C library for AVR-GCC
+#include <avr/io.h>         // AVR device-specific IO definitions
+
+/* Function prototypes -----------------------------------------------*/
+/**
+ * @name Functions
+ */
+
+/**
+ * @brief  Configure pin and Timer/Counter1 Output Compare B unit.
+ * @param  reg_name Address of Data Direction Register, such as &DDRB.
+ * @param  pin_num  Servo signal pin designation in the interval 0 to 7.
+ * @return none
+ */
+void servo_init(volatile uint8_t *reg_name, uint8_t pin_num);
+
+/**
+ * @brief  Set pulse width of the 50 Hz pulse train.
+ * @param  us Pulse width in microseconds, limited to interval 
+ *            SERVO_MIN_US to SERVO_MAX_US.
+ * @return none
+ */
+void servo_set_us(uint16_t us);
+
+/**
+ * @brief  Set servo angle.
+ * @param  angle Angle in degrees in the interval 0 to 180.
+ * @return none
+ */
+void servo_set_angle(uint8_t angle);
+
+/** @} */
+
+#endif /* SERVO_H_ */
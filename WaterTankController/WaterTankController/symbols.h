@@ -13,7 +13,13 @@
 #ifndef SYMBOLS_H_
 #define SYMBOLS_H_
 
-uint16_t customChar[] = {
+#include <avr/pgmspace.h>   // Program space utilities
+
+// Number of 8-row characters in the table
+#define CUSTOM_CHARS 6
+
+// Bitmaps stay in flash, lcd_load_glyphs_p() copies them to CGRAM
+const uint8_t customChar[CUSTOM_CHARS * 8] PROGMEM = {
     // Tank is empty
     0B10001,    
     0B10001,
@@ -0,0 +1,197 @@
+/***********************************************************************
+ *
+ * USART telemetry stream for AVR-GCC.
+ * ATmega328P (Arduino Uno), 16 MHz, AVR 8-bit Toolchain 3.6.2
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/* Includes ----------------------------------------------------------*/
+#include <avr/interrupt.h>  // Interrupts standard C library for AVR-GCC
+#include <avr/power.h>      // Power reduction management
+#include <stdlib.h>         // C library for conversion function
+#include <util/crc16.h>     // CRC computations
+#include "telemetry.h"
+
+/* Variables ---------------------------------------------------------*/
+// Bytes waiting for transmission
+static volatile uint8_t buffer[TELEMETRY_BUFFER];
+// Next byte to write, owned by telemetry_send()
+static volatile uint8_t head;
+// Next byte to send, owned by interrupt
+static volatile uint8_t tail;
+// Sequence number of the next frame
+static uint8_t sequence;
+// Frames lost because the line was too slow
+static uint8_t dropped;
+
+/* Function definitions ----------------------------------------------*/
+/**********************************************************************
+ * Function: telemetry_init()
+ * Purpose:  Power USART0 up and enable transmitter, 8N1. Receiver
+ *           stays off because RXD (PD0) is trigger of the sensor.
+ * Input:    none
+ * Returns:  none
+ **********************************************************************/
+void telemetry_init()
+{
+    power_usart0_enable();
+
+    // Double speed, 8 samples per bit
+    UBRR0 = (F_CPU / 8 + TELEMETRY_BAUD / 2) / TELEMETRY_BAUD - 1;
+    UCSR0A = (1<<U2X0);
+    UCSR0C = (1<<UCSZ01) | (1<<UCSZ00);
+    UCSR0B = (1<<TXEN0);
+
+    head = 0;
+    tail = 0;
+    sequence = 0;
+    dropped = 0;
+}
+
+#if TELEMETRY_CSV
+/**********************************************************************
+ * Function: append_number()
+ * Purpose:  Append decimal number and separator to a text line.
+ * Input:    p         - End of the line
+ *           value     - Number to append
+ *           separator - Character written after the number
+ * Returns:  New end of the line
+ **********************************************************************/
+static char *append_number(char *p, int32_t value, char separator)
+{
+    if (value < 0) {
+        *p++ = '-';
+        value = -value;
+    }
+    utoa((uint16_t)value, p, 10);
+    while (*p)
+        ++p;
+    *p++ = separator;
+
+    return p;
+}
+
+/**********************************************************************
+ * Function: encode()
+ * Purpose:  Format one text line.
+ * Input:    frame  - Destination, at least 64 bytes
+ *           sample - Values to send
+ * Returns:  Line length
+ **********************************************************************/
+static uint8_t encode(uint8_t *frame, const telemetry_sample_t *sample)
+{
+    char *p = (char *)frame;
+
+    p = append_number(p, sequence, ',');
+    p = append_number(p, sample->echo_ticks, ',');
+    p = append_number(p, sample->raw_cm, ',');
+    p = append_number(p, sample->distance_cm, ',');
+    p = append_number(p, sample->litres, ',');
+    p = append_number(p, sample->percent, ',');
+    p = append_number(p, sample->flags, ',');
+    p = append_number(p, sample->temperature, ',');
+    p = append_number(p, sample->isr_latency_max, ',');
+    p = append_number(p, sample->overruns, ',');
+    p = append_number(p, dropped, '\n');
+
+    return p - (char *)frame;
+}
+#else
+/**********************************************************************
+ * Function: encode()
+ * Purpose:  Pack one binary frame.
+ * Input:    frame  - Destination, TELEMETRY_FRAME bytes
+ *           sample - Values to send
+ * Returns:  Frame length
+ **********************************************************************/
+static uint8_t encode(uint8_t *frame, const telemetry_sample_t *sample)
+{
+    uint8_t *p = frame;
+    uint8_t crc = 0;
+
+    *p++ = TELEMETRY_SYNC;
+    *p++ = TELEMETRY_PAYLOAD;
+    *p++ = sequence;
+    *p++ = sample->echo_ticks & 0xFF;
+    *p++ = sample->echo_ticks >> 8;
+    *p++ = sample->raw_cm & 0xFF;
+    *p++ = sample->raw_cm >> 8;
+    *p++ = sample->distance_cm & 0xFF;
+    *p++ = sample->distance_cm >> 8;
+    *p++ = sample->litres & 0xFF;
+    *p++ = sample->litres >> 8;
+    *p++ = sample->percent;
+    *p++ = sample->flags;
+    *p++ = (uint8_t)sample->temperature;
+    *p++ = sample->isr_latency_max & 0xFF;
+    *p++ = sample->isr_latency_max >> 8;
+    *p++ = sample->overruns;
+    *p++ = dropped;
+
+    // Sync byte is excluded, receiver hunts for it
+    for (uint8_t i = 1; i < TELEMETRY_FRAME - 1; i++)
+        crc = _crc8_ccitt_update(crc, frame[i]);
+    *p++ = crc;
+
+    return TELEMETRY_FRAME;
+}
+#endif
+
+/**********************************************************************
+ * Function: telemetry_send()
+ * Purpose:  Copy frame to the ring buffer and let the interrupt send
+ *           it, drop the whole frame if it does not fit.
+ * Input:    sample - Values to send
+ * Returns:  1 if frame was queued, 0 if it was dropped
+ **********************************************************************/
+uint8_t telemetry_send(const telemetry_sample_t *sample)
+{
+    uint8_t frame[64];
+    uint8_t length = encode(frame, sample);
+    uint8_t next = head;
+
+    ++sequence;
+
+    if (((tail - next - 1) & TELEMETRY_MASK) < length) {
+        if (dropped != 0xFF)
+            ++dropped;
+        return 0;
+    }
+
+    for (uint8_t i = 0; i < length; i++) {
+        buffer[next] = frame[i];
+        next = (next + 1) & TELEMETRY_MASK;
+    }
+    // Publish bytes only after they are written
+    head = next;
+
+    // Only this bit of UCSR0B ever changes after init, the interrupt
+    // clearing it meanwhile just costs one extra empty interrupt
+    UCSR0B |= (1<<UDRIE0);
+
+    return 1;
+}
+
+/* Interrupt service routines ----------------------------------------*/
+/**********************************************************************
+ * Function: USART data register empty interrupt
+ * Purpose:  Send next byte of the ring buffer, disable itself when the
+ *           buffer is empty.
+ **********************************************************************/
+ISR(USART_UDRE_vect)
+{
+    uint8_t current = tail;
+
+    if (current == head) {
+        UCSR0B &= ~(1<<UDRIE0);
+        return;
+    }
+
+    UDR0 = buffer[current];
+    tail = (current + 1) & TELEMETRY_MASK;
+}
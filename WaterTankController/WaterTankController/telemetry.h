@@ -0,0 +1,121 @@
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+/***********************************************************************
+ *
+ * USART telemetry stream for AVR-GCC.
+ * ATmega328P (Arduino Uno), 16 MHz, AVR 8-bit Toolchain 3.6.2
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/**
+ * @file
+ * @defgroup telemetry USART telemetry stream <telemetry.h>
+ * @code #include "telemetry.h" @endcode
+ *
+ * @brief One frame per measurement on TXD (PD1), transmit only.
+ *
+ * Frames are copied to a ring buffer and sent by the USART data
+ * register empty interrupt, so telemetry_send() never waits for the
+ * line. A frame which does not fit into the buffer is dropped as a
+ * whole and counted, the count is part of the next frames.
+ *
+ * Binary frame, multi-byte fields little endian:
+ *
+ * | Offset | Size | Field                                       |
+ * | ------ | ---- | ------------------------------------------- |
+ * | 0      | 1    | TELEMETRY_SYNC                              |
+ * | 1      | 1    | Payload length, TELEMETRY_PAYLOAD           |
+ * | 2      | 1    | Sequence number                             |
+ * | 3      | 2    | Raw echo length in TIM1 ticks               |
+ * | 5      | 2    | Raw distance in cm                          |
+ * | 7      | 2    | Filtered distance in cm                     |
+ * | 9      | 2    | Volume in litres                            |
+ * | 11     | 1    | Fill level in %                             |
+ * | 12     | 1    | Flags, bit 0 pump on, bit 1 valve open      |
+ * | 13     | 1    | Temperature in degrees Celsius, signed      |
+ * | 14     | 2    | Worst interrupt latency in TIM1 ticks       |
+ * | 16     | 1    | Event queue overruns                        |
+ * | 17     | 1    | Dropped telemetry frames                    |
+ * | 18     | 1    | CRC-8 (polynomial 0x07) of bytes 1 to 17    |
+ *
+ * With TELEMETRY_CSV the same fields from sequence number on are sent
+ * as one comma separated text line instead.
+ *
+ * @{
+ */
+
+/* Includes ----------------------------------------------------------*/
+#include <avr/io.h>         // AVR device-specific IO definitions
+
+/* Defines -----------------------------------------------------------*/
+#ifndef F_CPU
+#define F_CPU 16000000UL    // CPU frequency in Hz
+#endif
+#ifndef TELEMETRY_BAUD
+#define TELEMETRY_BAUD  1000000UL // Exact with U2X0 at 16 MHz
+#endif
+#ifndef TELEMETRY_CSV
+#define TELEMETRY_CSV   0   // Send text lines instead of binary frames
+#endif
+#ifndef TELEMETRY_BUFFER
+#if TELEMETRY_CSV
+#define TELEMETRY_BUFFER 128 // Ring buffer size, must be power of two
+#else
+#define TELEMETRY_BUFFER 64  // Ring buffer size, must be power of two
+#endif
+#endif
+#define TELEMETRY_MASK    (TELEMETRY_BUFFER - 1)
+#define TELEMETRY_SYNC    0xA5  // First byte of binary frame
+#define TELEMETRY_PAYLOAD 16    // Bytes between length and CRC
+#define TELEMETRY_FRAME   (TELEMETRY_PAYLOAD + 3)
+
+#define TELEMETRY_PUMP_ON    (1<<0)
+#define TELEMETRY_VALVE_OPEN (1<<1)
+#define TELEMETRY_FAULT_SHIFT 2     // Active faults in upper bits
+
+#if TELEMETRY_BUFFER & TELEMETRY_MASK
+#error "TELEMETRY_BUFFER must be power of two"
+#endif
+
+/* Types -------------------------------------------------------------*/
+/** @brief Values reported for one measurement */
+typedef struct {
+    uint16_t echo_ticks;     // Raw echo length in TIM1 ticks
+    uint16_t raw_cm;         // Distance before filtering
+    uint16_t distance_cm;    // Filtered distance
+    uint16_t litres;         // Volume of water
+    uint8_t percent;         // Fill level
+    uint8_t flags;           // TELEMETRY_PUMP_ON, TELEMETRY_VALVE_OPEN, faults
+    int8_t temperature;      // Air temperature in degrees Celsius
+    uint16_t isr_latency_max; // Worst interrupt latency in TIM1 ticks
+    uint8_t overruns;        // Event queue overruns
+} telemetry_sample_t;
+
+/* Function prototypes -----------------------------------------------*/
+/**
+ * @name Functions
+ */
+
+/**
+ * @brief  Power USART0 up and enable transmitter, 8N1.
+ * @param  none
+ * @return none
+ */
+void telemetry_init();
+
+/**
+ * @brief  Queue one frame for transmission, never waits.
+ * @param  sample Values to send.
+ * @return 1 if frame was queued, 0 if it was dropped
+ */
+uint8_t telemetry_send(const telemetry_sample_t *sample);
+
+/** @} */
+
+#endif /* TELEMETRY_H_ */
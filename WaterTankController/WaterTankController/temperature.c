@@ -0,0 +1,97 @@
+/***********************************************************************
+ *
+ * Internal temperature sensor library for AVR-GCC.
+ * ATmega328P (Arduino Uno), 16 MHz, AVR 8-bit Toolchain 3.6.2
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/* Includes ----------------------------------------------------------*/
+#include <avr/power.h>      // Power reduction management
+#include "temperature.h"
+
+/* Defines -----------------------------------------------------------*/
+#define TEMPERATURE_MIN_Q8  (-40 * 256)
+#define TEMPERATURE_MAX_Q8  (85 * 256)
+
+/* Variables ---------------------------------------------------------*/
+// Averaged temperature in 1/256 degrees Celsius
+static int16_t temperature_q8;
+// 0 before first reading, 1 before first valid reading, then 2
+static uint8_t readings;
+
+/* Function definitions ----------------------------------------------*/
+/**********************************************************************
+ * Function: temperature_init()
+ * Purpose:  Select internal sensor with 1.1 V reference and start
+ *           first conversion.
+ * Input:    none
+ * Returns:  none
+ **********************************************************************/
+void temperature_init()
+{
+    power_adc_enable();
+
+    // Internal 1.1 V reference, MUX 1000 selects temperature sensor
+    ADMUX = (1<<REFS1) | (1<<REFS0) | (1<<MUX3);
+    // Enable ADC with 125 kHz clock and start conversion
+    ADCSRA = (1<<ADEN) | (1<<ADSC) | (1<<ADPS2) | (1<<ADPS1) | (1<<ADPS0);
+
+    readings = 0;
+    temperature_q8 = 0;
+}
+
+/**********************************************************************
+ * Function: temperature_update()
+ * Purpose:  Collect finished conversion, average it and start the
+ *           next one.
+ * Input:    none
+ * Returns:  1 if temperature was updated, 0 if conversion is running
+ **********************************************************************/
+uint8_t temperature_update()
+{
+    int32_t sample;
+
+    if (ADCSRA & (1<<ADSC))
+        return 0;
+
+    sample = ((int32_t)ADC - TEMPERATURE_OFFSET) * TEMPERATURE_GAIN_Q8;
+    ADCSRA |= (1<<ADSC);
+
+    // Keep within operating range of the chip
+    if (sample > TEMPERATURE_MAX_Q8)
+        sample = TEMPERATURE_MAX_Q8;
+    if (sample < TEMPERATURE_MIN_Q8)
+        sample = TEMPERATURE_MIN_Q8;
+
+    if (readings == 0) {
+        // First conversion after reference switch is not accurate
+        readings = 1;
+        return 0;
+    }
+
+    if (readings == 1) {
+        temperature_q8 = sample;
+        readings = 2;
+    }
+    else {
+        temperature_q8 += (sample - temperature_q8) >> TEMPERATURE_SMOOTHING;
+    }
+
+    return 1;
+}
+
+/**********************************************************************
+ * Function: temperature_get()
+ * Purpose:  Averaged temperature.
+ * Input:    none
+ * Returns:  Temperature in degrees Celsius
+ **********************************************************************/
+int8_t temperature_get()
+{
+    return (temperature_q8 + 128) >> 8;
+}
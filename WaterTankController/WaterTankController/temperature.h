@@ -0,0 +1,72 @@
+#ifndef TEMPERATURE_H_
+#define TEMPERATURE_H_
+
+/***********************************************************************
+ *
+ * Internal temperature sensor library for AVR-GCC.
+ * ATmega328P (Arduino Uno), 16 MHz, AVR 8-bit Toolchain 3.6.2
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/**
+ * @file
+ * @defgroup temperature Internal temperature sensor <temperature.h>
+ * @code #include "temperature.h" @endcode
+ *
+ * @brief Air temperature from the on-chip sensor on ADC channel 8.
+ *
+ * Conversions run in background and are collected by polling, so no
+ * caller ever waits for the ADC. The chip draws little current in
+ * idle sleep and stays close to air temperature. Offset of the sensor
+ * varies between chips, TEMPERATURE_OFFSET should be calibrated for
+ * accurate results.
+ *
+ * @{
+ */
+
+/* Includes ----------------------------------------------------------*/
+#include <avr/io.h>         // AVR device-specific IO definitions
+
+/* Defines -----------------------------------------------------------*/
+#ifndef TEMPERATURE_OFFSET
+#define TEMPERATURE_OFFSET  324 // ADC reading at 0 degrees Celsius
+#endif
+#ifndef TEMPERATURE_GAIN_Q8
+#define TEMPERATURE_GAIN_Q8 210 // Degrees per LSB * 2^8, i.e. 1/1.22
+#endif
+#define TEMPERATURE_SMOOTHING 3 // Average weight of new reading 1/2^n
+
+/* Function prototypes -----------------------------------------------*/
+/**
+ * @name Functions
+ */
+
+/**
+ * @brief  Power ADC up and start first conversion of the sensor.
+ * @param  none
+ * @return none
+ */
+void temperature_init();
+
+/**
+ * @brief  Collect finished conversion and start the next one.
+ * @param  none
+ * @return 1 if temperature was updated, 0 if conversion is running
+ */
+uint8_t temperature_update();
+
+/**
+ * @brief  Averaged temperature.
+ * @param  none
+ * @return Temperature in degrees Celsius
+ */
+int8_t temperature_get();
+
+/** @} */
+
+#endif /* TEMPERATURE_H_ */
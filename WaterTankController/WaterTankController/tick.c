@@ -0,0 +1,230 @@
+/***********************************************************************
+ *
+ * Millisecond tick and software timer wheel for AVR-GCC.
+ * ATmega328P (Arduino Uno), 16 MHz, AVR 8-bit Toolchain 3.6.2
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/* Includes ----------------------------------------------------------*/
+#include <stddef.h>         // NULL
+#include <util/atomic.h>    // Atomically and Non-Atomically Executed Code Blocks
+#include "tick.h"
+
+/* Defines -----------------------------------------------------------*/
+#define TICK_COMPARE 249    // 16 MHz / 64 / (249 + 1) = 1 kHz
+
+/* Variables ---------------------------------------------------------*/
+// Milliseconds since start, written by interrupt only
+static volatile uint32_t ticks;
+// Timers linked by the slot of their expiry
+static soft_timer_t *wheel[TICK_WHEEL_SLOTS];
+// Rest of the slot being expired by tick_handle()
+static soft_timer_t *expiring;
+
+/* Function definitions ----------------------------------------------*/
+/**********************************************************************
+ * Function: tick_init()
+ * Purpose:  Start Timer/Counter0 in CTC mode with 1 ms period.
+ * Input:    none
+ * Returns:  none
+ **********************************************************************/
+void tick_init()
+{
+    for (uint8_t i = 0; i < TICK_WHEEL_SLOTS; i++)
+        wheel[i] = NULL;
+    ticks = 0;
+
+    TCNT0 = 0;
+    OCR0A = TICK_COMPARE;
+    TCCR0A = (1<<WGM01);
+    TCCR0B = (1<<CS01) | (1<<CS00);
+    TIMSK0 |= (1<<OCIE0A);
+}
+
+/**********************************************************************
+ * Function: wheel_link()
+ * Purpose:  Push timer to the head of a list. Interrupts must be
+ *           disabled.
+ * Input:    head  - Head of slot list or of the expiring rest
+ *           timer - Timer structure
+ * Returns:  none
+ **********************************************************************/
+static void wheel_link(soft_timer_t **head, soft_timer_t *timer)
+{
+    timer->next = *head;
+    if (timer->next)
+        timer->next->link = &timer->next;
+    timer->link = head;
+    *head = timer;
+}
+
+/**********************************************************************
+ * Function: wheel_insert()
+ * Purpose:  Link timer into the slot of its expiry. Interrupts must be
+ *           disabled.
+ * Input:    timer - Timer structure
+ *           ms    - Delay from the current tick
+ * Returns:  none
+ **********************************************************************/
+static void wheel_insert(soft_timer_t *timer, uint16_t ms)
+{
+    uint8_t slot;
+
+    if (!ms)
+        ms = 1;
+
+    // Slot is visited every TICK_WHEEL_SLOTS ticks, the visit at
+    // expiry is the last one
+    slot = (uint8_t)(ticks + ms) & TICK_WHEEL_MASK;
+    timer->rounds = (ms - 1) >> TICK_WHEEL_SHIFT;
+    wheel_link(&wheel[slot], timer);
+}
+
+/**********************************************************************
+ * Function: wheel_remove()
+ * Purpose:  Unlink active timer through its back-link, also from the
+ *           expiring rest of a slot. Interrupts must be disabled.
+ * Input:    timer - Timer structure
+ * Returns:  none
+ **********************************************************************/
+static void wheel_remove(soft_timer_t *timer)
+{
+    *timer->link = timer->next;
+    if (timer->next)
+        timer->next->link = timer->link;
+    timer->link = NULL;
+}
+
+/**********************************************************************
+ * Function: tick_handle()
+ * Purpose:  Count one millisecond and expire timers of the current
+ *           slot. The slot list is detached first and timers are taken
+ *           from its head one by one, so callbacks may start or stop
+ *           any timer, including the ones still waiting in the list.
+ * Input:    none
+ * Returns:  none
+ **********************************************************************/
+void tick_handle()
+{
+    soft_timer_t *timer;
+    uint8_t slot;
+
+    ++ticks;
+    slot = (uint8_t)ticks & TICK_WHEEL_MASK;
+    expiring = wheel[slot];
+    if (expiring)
+        expiring->link = &expiring;
+    wheel[slot] = NULL;
+
+    while (expiring) {
+        timer = expiring;
+        expiring = timer->next;
+        if (expiring)
+            expiring->link = &expiring;
+
+        if (timer->rounds) {
+            --timer->rounds;
+            wheel_link(&wheel[slot], timer);
+        }
+        else {
+            timer->link = NULL;
+            if (timer->period)
+                wheel_insert(timer, timer->period);
+            timer->callback();
+        }
+    }
+}
+
+/**********************************************************************
+ * Function: tick_millis()
+ * Purpose:  Milliseconds since tick_init().
+ * Input:    none
+ * Returns:  Tick count
+ **********************************************************************/
+uint32_t tick_millis()
+{
+    uint32_t now;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        now = ticks;
+    }
+
+    return now;
+}
+
+/**********************************************************************
+ * Function: timer_start()
+ * Purpose:  Common body of timer_after() and timer_every().
+ * Input:    timer    - Timer structure
+ *           ms       - Delay in ms
+ *           period   - Reload in ms, 0 for one-shot
+ *           callback - Function to call
+ * Returns:  none
+ **********************************************************************/
+static void timer_start(soft_timer_t *timer, uint16_t ms, uint16_t period,
+                        soft_timer_callback_t callback)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (timer->link)
+            wheel_remove(timer);
+        timer->callback = callback;
+        timer->period = period;
+        wheel_insert(timer, ms);
+    }
+}
+
+/**********************************************************************
+ * Function: timer_after()
+ * Purpose:  Call function once after a delay.
+ * Input:    timer    - Timer structure
+ *           ms       - Delay in ms
+ *           callback - Function to call
+ * Returns:  none
+ **********************************************************************/
+void timer_after(soft_timer_t *timer, uint16_t ms, soft_timer_callback_t callback)
+{
+    timer_start(timer, ms, 0, callback);
+}
+
+/**********************************************************************
+ * Function: timer_every()
+ * Purpose:  Call function periodically, first call after one period.
+ * Input:    timer    - Timer structure
+ *           ms       - Period in ms
+ *           callback - Function to call
+ * Returns:  none
+ **********************************************************************/
+void timer_every(soft_timer_t *timer, uint16_t ms, soft_timer_callback_t callback)
+{
+    timer_start(timer, ms, ms ? ms : 1, callback);
+}
+
+/**********************************************************************
+ * Function: timer_cancel()
+ * Purpose:  Stop timer.
+ * Input:    timer - Timer structure
+ * Returns:  none
+ **********************************************************************/
+void timer_cancel(soft_timer_t *timer)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (timer->link)
+            wheel_remove(timer);
+    }
+}
+
+/**********************************************************************
+ * Function: timer_is_active()
+ * Purpose:  Check whether timer waits for expiry.
+ * Input:    timer - Timer structure
+ * Returns:  1 if active, 0 otherwise
+ **********************************************************************/
+uint8_t timer_is_active(const soft_timer_t *timer)
+{
+    return timer->link != NULL;
+}
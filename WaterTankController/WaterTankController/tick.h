@@ -0,0 +1,121 @@
+#ifndef TICK_H_
+#define TICK_H_
+
+/***********************************************************************
+ *
+ * Millisecond tick and software timer wheel for AVR-GCC.
+ * ATmega328P (Arduino Uno), 16 MHz, AVR 8-bit Toolchain 3.6.2
+ *
+ * Copyright (c) 2021 Shelemba Pavlo
+ * Copyright (c) 2021 Tomešek Jiří
+ * Copyright (c) 2021 Točený Ivo
+ * This work is licensed under the terms of the MIT license
+ *
+ **********************************************************************/
+
+/**
+ * @file
+ * @defgroup tick Millisecond tick and timer wheel <tick.h>
+ * @code #include "tick.h" @endcode
+ *
+ * @brief One 1 ms time base on Timer/Counter0 for all periodic work.
+ *
+ * Timer/Counter0 runs in CTC mode with prescaler 64 and compare value
+ * 249, which gives exactly 1 ms at 16 MHz. Its compare match interrupt
+ * calls tick_handle(), which advances the millisecond counter and one
+ * slot of a hashed timer wheel.
+ *
+ * A timer due in d ms goes to slot (now + d) % TICK_WHEEL_SLOTS with
+ * (d - 1) / TICK_WHEEL_SLOTS rounds left, so starting a timer is O(1)
+ * and every tick only visits the timers of one slot. Every timer keeps
+ * the address of the pointer which links it, so a timer is unlinked in
+ * O(1) as well. Callbacks run in interrupt context and must be short.
+ * Timer structures belong to the caller and must stay valid while the
+ * timer is active.
+ *
+ * @{
+ */
+
+/* Includes ----------------------------------------------------------*/
+#include <avr/io.h>         // AVR device-specific IO definitions
+
+/* Defines -----------------------------------------------------------*/
+#define TICK_WHEEL_SHIFT 4                         // 16 slots
+#define TICK_WHEEL_SLOTS (1 << TICK_WHEEL_SHIFT)
+#define TICK_WHEEL_MASK  (TICK_WHEEL_SLOTS - 1)
+#define TICK_TIM1_TICKS  8  // TIM1 ticks per TCNT0 tick, prescaler 64 vs 8
+
+/* Types -------------------------------------------------------------*/
+/** @brief Called from tick interrupt when a timer expires */
+typedef void (*soft_timer_callback_t)(void);
+
+/** @brief Software timer, fields are private to the wheel */
+typedef struct soft_timer {
+    struct soft_timer *next;        // Next timer in the same slot
+    struct soft_timer **link;       // Pointer to this timer, NULL if stopped
+    soft_timer_callback_t callback; // Function to call
+    uint16_t period;                // Reload in ms, 0 for one-shot
+    uint16_t rounds;                // Wheel turns before expiry
+} soft_timer_t;
+
+/* Function prototypes -----------------------------------------------*/
+/**
+ * @name Functions
+ */
+
+/**
+ * @brief  Start Timer/Counter0 with 1 ms compare match interrupt.
+ * @param  none
+ * @return none
+ */
+void tick_init();
+
+/**
+ * @brief  Advance time by one tick, call from TIMER0_COMPA interrupt.
+ * @param  none
+ * @return none
+ */
+void tick_handle();
+
+/**
+ * @brief  Milliseconds since tick_init(), wraps after 49 days.
+ * @param  none
+ * @return Tick count
+ */
+uint32_t tick_millis();
+
+/**
+ * @brief  Call function once after a delay, restarts an active timer.
+ * @param  timer    Timer structure owned by the caller
+ * @param  ms       Delay in ms, at least 1
+ * @param  callback Function to call in interrupt context
+ * @return none
+ */
+void timer_after(soft_timer_t *timer, uint16_t ms, soft_timer_callback_t callback);
+
+/**
+ * @brief  Call function periodically, restarts an active timer.
+ * @param  timer    Timer structure owned by the caller
+ * @param  ms       Period in ms, at least 1
+ * @param  callback Function to call in interrupt context
+ * @return none
+ */
+void timer_every(soft_timer_t *timer, uint16_t ms, soft_timer_callback_t callback);
+
+/**
+ * @brief  Stop timer, nothing happens if it is not active.
+ * @param  timer Timer structure
+ * @return none
+ */
+void timer_cancel(soft_timer_t *timer);
+
+/**
+ * @brief  Check whether timer waits for expiry.
+ * @param  timer Timer structure
+ * @return 1 if active, 0 otherwise
+ */
+uint8_t timer_is_active(const soft_timer_t *timer);
+
+/** @} */
+
+#endif /* TICK_H_ */
@@ -9,162 +9,349 @@
  **********************************************************************/
 
 /* Includes ----------------------------------------------------------*/
+#include <util/atomic.h>     // Atomically and Non-Atomically Executed Code Blocks
 #include "ultrasonic.h"
 
+/* Variables ---------------------------------------------------------*/
+// Sensor descriptor table owned by the application
+static ultrasonic_sensor_t *sensor_table;
+static uint8_t sensor_count;
+// Sensor triggered last by round-robin
+static uint8_t sensor_next;
+// Port Register and pin mask of the trigger pulse in progress
+static volatile uint8_t *pulse_port;
+static uint8_t pulse_mask;
+// Distance of one TIM1 tick at current speed of sound
+static uint16_t cm_per_tick_q20 = ULTRASONIC_CM_PER_TICK_Q20;
+static uint16_t mm_per_tick_q16 = ULTRASONIC_MM_PER_TICK_Q16;
+
 /* Function definitions ----------------------------------------------*/
+/**********************************************************************
+ * Function: ultrasonic_publish()
+ * Purpose:  Write result of a ping to the sample slot of a sensor.
+ *           Call with interrupts disabled, readers are not blocked.
+ * Input:    sensor - Sensor descriptor
+ *           ticks  - Echo length in TIM1 ticks
+ *           status - ultrasonic_status_t
+ * Returns:  none
+ **********************************************************************/
+static void ultrasonic_publish(ultrasonic_sensor_t *sensor, uint16_t ticks, uint8_t status)
+{
+    // Odd sequence tells readers the slot is being written
+    ++sensor->sequence;
+    sensor->slot_ticks = ticks;
+    sensor->slot_ms = tick_millis();
+    sensor->slot_status = status;
+    ++sensor->sequence;
+}
+
 /**********************************************************************
  * Function: ultrasonic_init()
- * Purpose:  Configure pin and Timer/Counter1 for use with HC-SR04
- * Input:    trig_reg Address of Data Direction Register, such as &DDRB
- *           trig_pin Trigger pin designation in the interval 0 to 7
- *           echo_reg Address of Data Direction Register, such as &DDRB
- *           echo_pin Incoming signal pin designation in the interval 
- *                    0 to 7
+ * Purpose:  Configure pins of all sensors, pin change interrupts of
+ *           their echo inputs, Timer/Counter1 and 2
+ * Input:    sensors - Sensor descriptor table
+ *           count   - Number of sensors in the table, at most
+ *                     ULTRASONIC_MAX_SENSORS are used
  * Returns:  none
  **********************************************************************/
-void ultrasonic_init(volatile uint8_t *trig_reg, uint8_t trig_pin, volatile uint8_t *echo_reg, uint8_t echo_pin)
+void ultrasonic_init(ultrasonic_sensor_t *sensors, uint8_t count)
 {
-    signal_pin = echo_pin;
-
-    // Configure trigger pin Data Direction Register as output
-    *trig_reg |= (1<<trig_pin);
-    // Move pointer to address of Port Register
-    ++trig_reg;
-    // Drive port pin low
-    *trig_reg &= ~(1<<trig_pin);
-
-    // Configure echo signal pin Data Direction Register as input
-    *echo_reg &= ~(1<<signal_pin);
-    // Move pointer to address of Port Register
-    ++echo_reg;
-    // Enable pull-up resistor
-    *echo_reg |= (1<<signal_pin);
-    // Move pointer back to address of Data Direction Register
-    --echo_reg;
-    
-    if (*echo_reg == DDRB) {
-        // Any change on any enabled PCINT[7:0] pin will cause an interrupt
-        PCICR |= (1<<PCIE0);
-        // Enable pin change interrupt on the corresponding I/O pin
-        PCMSK0 |= (1<<signal_pin);
-    }
-    if (*echo_reg == DDRC) {
-        PCICR |= (1<<PCIE1);
-        PCMSK1 |= (1<<signal_pin);
-    }
-    if (*echo_reg == DDRD) {
-        if (signal_pin == PIN_INT1) {
-            // Rising edge on INT1 generates an interrupt request
-            EICRA |= (1<<ISC11) | (1<<ISC10);
-            // Enable External Interrupt Requests
-            EIMSK |= (1<<INT1);
+    // Bit of a further sensor would not fit the returned masks
+    if (count > ULTRASONIC_MAX_SENSORS)
+        count = ULTRASONIC_MAX_SENSORS;
+
+    sensor_table = sensors;
+    sensor_count = count;
+    sensor_next = 0;
+
+    for (uint8_t i = 0; i < count; i++) {
+        ultrasonic_sensor_t *sensor = &sensors[i];
+        volatile uint8_t *reg = sensor->trig_reg;
+
+        // Configure trigger pin Data Direction Register as output
+        *reg |= (1<<sensor->trig_pin);
+        // Move pointer to address of Port Register
+        ++reg;
+        // Drive port pin low
+        *reg &= ~(1<<sensor->trig_pin);
+
+        reg = sensor->echo_reg;
+        // Configure echo signal pin Data Direction Register as input
+        *reg &= ~(1<<sensor->echo_pin);
+        // Move pointer to address of Port Register
+        ++reg;
+        // Enable pull-up resistor
+        *reg |= (1<<sensor->echo_pin);
+
+        // Any change of echo pin causes pin change interrupt of its port
+        if (sensor->echo_reg == &DDRB) {
+            PCICR |= (1<<PCIE0);
+            PCMSK0 |= (1<<sensor->echo_pin);
         }
-        else if (signal_pin == PIN_INT0) {
-            // Rising edge on INT0 generates an interrupt request
-            EICRA |= (1<<ISC01) | (1<<ISC00);
-            // Enable External Interrupt Requests
-            EIMSK |= (1<<INT0);
+        else if (sensor->echo_reg == &DDRC) {
+            PCICR |= (1<<PCIE1);
+            PCMSK1 |= (1<<sensor->echo_pin);
         }
-        else {
+        else if (sensor->echo_reg == &DDRD) {
             PCICR |= (1<<PCIE2);
-            PCMSK2 |= (1<<signal_pin);
+            PCMSK2 |= (1<<sensor->echo_pin);
         }
+
+        sensor->armed = 0;
+        sensor->echo_high = 0;
+        sensor->sequence = 0;
+        sensor->slot_ticks = 0;
+        sensor->slot_ms = 0;
+        sensor->slot_status = ULTRASONIC_NONE;
     }
 
-    // 340 m/s sound wave propagates by 1 cm in ~58,8235 us
-    // Empirical measurement suggests that 930 clocks of TIM1
-    // with prescaler N=1 takes almost the same amount of time
-    // Set max TIM1 value to this clock number
-    OCR1A = 930;
-    // Enable Timer/Counter1 Output Compare A Match interrupt
-    TIMSK1 |= (1<<OCIE1A);
-    // Enable Timer/Counter1 Clear Timer on Compare Match mode
-    TCCR1B |= (1<<WGM12);
+    // Timer/Counter1 runs freely in Normal mode with prescaler N=8,
+    // both echo edges are timestamped from TCNT1 with 0.5 us resolution
+    TCCR1A = 0;
+    TCCR1B = (1<<CS11);
+
+    // Timer/Counter2 stays stopped in Normal mode until a trigger pulse
+    // starts it, compare match A ends the pulse
+    TCCR2A = 0;
+    TCCR2B = 0;
+    OCR2A = ULTRASONIC_PULSE_TICKS;
 }
 
 /**********************************************************************
  * Function: ultrasonic_trigger()
- * Purpose:  Trigger ultrasonic sensor by sending 10us pulse.
- * Input:    reg_name - Address of Port Register, such as &PORTB
- *           pin_num  - Pin connected to trigger input of HC-SR04
+ * Purpose:  Trigger one sensor by starting 10us pulse and accept its
+ *           next echo. Timer/Counter2 ends the pulse, so the caller
+ *           does not wait.
+ * Input:    id - Index of sensor in descriptor table
  * Returns:  none
  **********************************************************************/
-void ultrasonic_trigger(volatile uint8_t *reg_name, uint8_t pin_num)
+void ultrasonic_trigger(uint8_t id)
 {
-    *reg_name |= (1<<pin_num);
-    _delay_us(10);
-    *reg_name &= ~(1<<pin_num);
+    ultrasonic_sensor_t *sensor = &sensor_table[id];
+
+    sensor->armed = 1;
+    sensor->echo_high = 0;
+
+    // Port Register follows Data Direction Register
+    pulse_port = sensor->trig_reg + 1;
+    pulse_mask = (1<<sensor->trig_pin);
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        *pulse_port |= pulse_mask;
+
+        // Count pulse width from zero with reset prescaler, so compare
+        // match comes exactly ULTRASONIC_PULSE_TICKS later
+        GTCCR = (1<<PSRASY);
+        TCNT2 = 0;
+        TIFR2 = (1<<OCF2A);
+        TIMSK2 |= (1<<OCIE2A);
+        TCCR2B = (1<<CS21);
+    }
 }
 
 /**********************************************************************
- * Function: ultrasonic_start_measuring()
- * Purpose:  Start Timer/Counter1.
+ * Function: ultrasonic_pulse_end()
+ * Purpose:  Drive trigger pin low and stop Timer/Counter2 until the
+ *           next trigger. Call from its compare match A interrupt.
  * Input:    none
  * Returns:  none
  **********************************************************************/
-void ultrasonic_start_measuring()
-{  
-    // Clear previous calculated distance before next measurement
-    distance = 0;
-    
-    // Start Timer/Counter1
-    TCCR1B &= ~((1<<CS12) | (1<<CS11)); 
-    TCCR1B |= (1<<CS10);
-    
-    if (signal_pin == PIN_INT1) {
-        // Detect falling edge of the signal if INT1 is used
-        EICRA |= (1<<ISC11);
-        EICRA &= ~(1<<ISC10);
-    }
-    else if (signal_pin == PIN_INT0) {
-        // Detect falling edge of the signal if INT0 is used
-        EICRA |= (1<<ISC01);
-        EICRA &= ~(1<<ISC00);
-    }
+void ultrasonic_pulse_end()
+{
+    *pulse_port &= ~pulse_mask;
+
+    TCCR2B = 0;
+    TIMSK2 &= ~(1<<OCIE2A);
 }
 
 /**********************************************************************
- * Function: ultrasonic_stop_measuring()
- * Purpose:  Stop Timer/Counter1.
+ * Function: ultrasonic_trigger_next()
+ * Purpose:  Trigger sensors one after another. Only one burst is in
+ *           the air at a time as long as calls are farther apart than
+ *           the longest echo, so sensors cannot hear each other.
  * Input:    none
- * Returns:  none
+ * Returns:  Index of triggered sensor
  **********************************************************************/
-void ultrasonic_stop_measuring()
+uint8_t ultrasonic_trigger_next()
 {
-    // Stop Timer/Counter1
-    TCCR1B &= ~((1<<CS12) | (1<<CS11) | (1<<CS10));
-    
-    if (signal_pin == PIN_INT1) {
-        // Detect rising edge of the signal if INT1 is used
-        EICRA |= (1<<ISC11) | (1<<ISC10);
-    }
-    else if (signal_pin == PIN_INT0) {
-        // Detect rising edge of the signal if INT0 is used
-        EICRA |= (1<<ISC01) | (1<<ISC00);
+    uint8_t id = sensor_next;
+
+    // Sensor which missed its echo does not accept a late one
+    for (uint8_t i = 0; i < sensor_count; i++)
+        sensor_table[i].armed = 0;
+
+    ultrasonic_trigger(id);
+
+    if (++sensor_next >= sensor_count)
+        sensor_next = 0;
+
+    return id;
+}
+
+/**********************************************************************
+ * Function: ultrasonic_echo_changed()
+ * Purpose:  Timestamp echo edges of all armed sensors on one port.
+ *           Call from pin change interrupt of the port.
+ * Input:    pin_reg - Address of Pin Register, such as &PIND
+ *           now     - TCNT1 read at the start of the interrupt
+ * Returns:  Bit mask of sensors whose echo has just completed
+ **********************************************************************/
+uint8_t ultrasonic_echo_changed(volatile uint8_t *pin_reg, uint16_t now)
+{
+    uint8_t level = *pin_reg;
+    uint8_t completed = 0;
+
+    for (uint8_t i = 0; i < sensor_count; i++) {
+        ultrasonic_sensor_t *sensor = &sensor_table[i];
+
+        // Pin Register precedes Data Direction Register
+        if (!sensor->armed || sensor->echo_reg - 1 != pin_reg)
+            continue;
+
+        if (level & (1<<sensor->echo_pin)) {
+            if (!sensor->echo_high) {
+                sensor->echo_start = now;
+                sensor->echo_high = 1;
+            }
+        }
+        else if (sensor->echo_high) {
+            // Free running TIM1 wraps around modulo 2^16 so plain
+            // subtraction gives the length
+            ultrasonic_publish(sensor, now - sensor->echo_start, ULTRASONIC_ECHO);
+            sensor->echo_high = 0;
+            sensor->armed = 0;
+            completed |= (1<<i);
+        }
     }
+
+    return completed;
 }
 
 /**********************************************************************
- * Function: ultrasonic_get_distance()
- * Purpose:  Stop measurement and get measured distance
+ * Function: ultrasonic_timeout()
+ * Purpose:  Disarm sensors still waiting for echo and publish their
+ *           timeout, so a missing or too long echo is never converted
+ *           to a distance.
  * Input:    none
+ * Returns:  Bit mask of sensors whose echo did not complete
+ **********************************************************************/
+uint8_t ultrasonic_timeout()
+{
+    uint8_t missed = 0;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        for (uint8_t i = 0; i < sensor_count; i++) {
+            if (sensor_table[i].armed) {
+                sensor_table[i].armed = 0;
+                sensor_table[i].echo_high = 0;
+                ultrasonic_publish(&sensor_table[i], 0, ULTRASONIC_NO_ECHO);
+                missed |= (1<<i);
+            }
+        }
+    }
+
+    return missed;
+}
+
+/**********************************************************************
+ * Function: ultrasonic_set_temperature()
+ * Purpose:  Correct distance conversion for speed of sound in air,
+ *           c = 331.3 + 0.606 * T m/s.
+ * Input:    celsius - Air temperature in degrees Celsius
+ * Returns:  none
+ **********************************************************************/
+void ultrasonic_set_temperature(int8_t celsius)
+{
+    // Speed of sound in dm/s, 0.606 approximated by 97/16
+    uint16_t speed = 3313 + ((int16_t)celsius * 97) / 16;
+
+    // One tick is 0.5 us there and back, 2.5e-6 cm per dm/s of speed,
+    // i.e. speed * 1.6384 mm in Q16 and speed * 2.62144 cm in Q20
+    mm_per_tick_q16 = ((uint32_t)speed * 26844 + (1UL << 13)) >> 14;
+    cm_per_tick_q20 = ((uint32_t)speed * 21475 + (1UL << 12)) >> 13;
+}
+
+/**********************************************************************
+ * Function: ultrasonic_get_sample()
+ * Purpose:  Copy the newest sample of a sensor. The copy is repeated
+ *           if an interrupt published a sample meanwhile, so it is
+ *           never torn and interrupts stay enabled.
+ * Input:    id     - Index of sensor in descriptor table
+ *           sample - Destination of the copy
+ * Returns:  none
+ **********************************************************************/
+void ultrasonic_get_sample(uint8_t id, ultrasonic_sample_t *sample)
+{
+    ultrasonic_sensor_t *sensor = &sensor_table[id];
+    uint8_t sequence;
+
+    do {
+        sequence = sensor->sequence;
+        sample->echo_ticks = sensor->slot_ticks;
+        sample->time_ms = sensor->slot_ms;
+        sample->status = sensor->slot_status;
+    } while ((sequence & 1) || sequence != sensor->sequence);
+
+    sample->sequence = sequence;
+}
+
+/**********************************************************************
+ * Function: ultrasonic_ticks_to_cm()
+ * Purpose:  Convert echo length to distance at current speed of sound
+ * Input:    echo_ticks - Echo length in TIM1 ticks
  * Returns:  Distance in cm
  **********************************************************************/
-uint16_t ultrasonic_get_distance()
+uint16_t ultrasonic_ticks_to_cm(uint16_t echo_ticks)
 {
-    // Stop counting echo
-    ultrasonic_stop_measuring();
+    return ((uint32_t)echo_ticks * cm_per_tick_q20 + (1UL << 19)) >> 20;
+}
 
-    return distance;    
+/**********************************************************************
+ * Function: ultrasonic_ticks_to_mm()
+ * Purpose:  Convert echo length to distance in millimetres at current
+ *           speed of sound
+ * Input:    echo_ticks - Echo length in TIM1 ticks
+ * Returns:  Distance in mm
+ **********************************************************************/
+uint16_t ultrasonic_ticks_to_mm(uint16_t echo_ticks)
+{
+    return ((uint32_t)echo_ticks * mm_per_tick_q16) >> 16;
+}
+
+/**********************************************************************
+ * Function: ultrasonic_get_echo_ticks()
+ * Purpose:  Length of the echo of the newest sample
+ * Input:    id - Index of sensor in descriptor table
+ * Returns:  Echo length in TIM1 ticks, 0 after timeout
+ **********************************************************************/
+uint16_t ultrasonic_get_echo_ticks(uint8_t id)
+{
+    ultrasonic_sample_t sample;
+
+    ultrasonic_get_sample(id, &sample);
+
+    return sample.echo_ticks;
+}
+
+/**********************************************************************
+ * Function: ultrasonic_get_distance()
+ * Purpose:  Get distance of the last completed measurement
+ * Input:    id - Index of sensor in descriptor table
+ * Returns:  Distance in cm
+ **********************************************************************/
+uint16_t ultrasonic_get_distance(uint8_t id)
+{
+    return ultrasonic_ticks_to_cm(ultrasonic_get_echo_ticks(id));
 }
 
-/* Interrupt service routines ----------------------------------------*/
 /**********************************************************************
- * Function: Timer/Counter1 compare match interrupt
- * Purpose:  Update distance every time timer is cleared on compare 
-*            match
+ * Function: ultrasonic_get_distance_mm()
+ * Purpose:  Get distance of the last completed measurement in 
+ *           millimetres
+ * Input:    id - Index of sensor in descriptor table
+ * Returns:  Distance in mm
  **********************************************************************/
-ISR(TIMER1_COMPA_vect)
+uint16_t ultrasonic_get_distance_mm(uint8_t id)
 {
-    ++distance;
+    return ultrasonic_ticks_to_mm(ultrasonic_get_echo_ticks(id));
 }
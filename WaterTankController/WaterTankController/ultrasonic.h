@@ -20,7 +20,18 @@
  * @brief HC-SR04 Ultrasonic sensor library for AVR-GCC.
  *
  * The library contains functions for controlling HC-SR04 Ultrasonic
- * Sensor.
+ * Sensor. Any number of sensors up to 8 is described by a table of
+ * ultrasonic_sensor_t, sensors are triggered round-robin and their
+ * echoes are timestamped from pin change interrupts against one
+ * shared free running Timer/Counter1. Each ping ends by publishing a
+ * sample, echo length or timeout, in a slot guarded by a sequence
+ * counter. The interrupt makes the counter odd while it writes, so a
+ * reader copies the slot without disabling interrupts and repeats the
+ * copy when the counter was odd or has moved meanwhile. A new echo may
+ * complete while the previous one is still being processed, the reader
+ * always gets the newest sample in one piece. Trigger pulse is started by
+ * ultrasonic_trigger() and ended by Timer/Counter2 compare match
+ * interrupt, so no caller busy-waits.
  *
  * @author Pavlo Shelemba
  * @copyright (c) 2021 Pavlo Shelemba. 
@@ -29,22 +40,60 @@
  */
 
 /* Defines -----------------------------------------------------------*/
-#define PIN_INT0    PIND2   // External interrupt 0 pin on ATmega328P
-#define PIN_INT1    PIND3   // External interrupt 1 pin on ATmega328P
-#ifndef F_CPU
-#define F_CPU 16000000UL    // CPU frequency in Hz for delay.h
-#endif
+// TIM1 runs with prescaler N=8, one tick takes 0.5 us. Sound wave at
+// 340 m/s travels there and back, so one tick equals 0.085 mm. These
+// are defaults until ultrasonic_set_temperature() is called
+#define ULTRASONIC_MM_PER_TICK_Q16 5571 // 0.085 mm * 2^16
+#define ULTRASONIC_CM_PER_TICK_Q20 8913 // 0.0085 cm * 2^20
+// Echo which has not completed by then is lost. HC-SR04 holds echo
+// high for 38 ms without reflection, which TIM1 cannot tell from a
+// short echo after wrapping around at 32.8 ms
+#define ULTRASONIC_TIMEOUT_MS 30        // ~5 m there and back
+// TIM2 runs only during trigger pulse with prescaler N=8, so the pulse
+// is ended by compare match after 20 ticks of 0.5 us
+#define ULTRASONIC_PULSE_TICKS 20       // 10 us trigger pulse
+// Completed and missed echoes are reported as 8-bit sensor masks
+#define ULTRASONIC_MAX_SENSORS 8
 
 /* Includes ----------------------------------------------------------*/
 #include <avr/interrupt.h>  // Interrupts standard C library for AVR-GCC
 #include <avr/io.h>         // AVR device-specific IO definitions
-#include <util/delay.h>     // Busy-wait delay loops
+#include "tick.h"           // Millisecond tick and timer wheel
 
-/* Variables ---------------------------------------------------------*/
-// Measured distance in cm
-uint16_t distance;
-// Incoming echo signal pin
-uint8_t  signal_pin;
+/* Types -------------------------------------------------------------*/
+/** @brief Result of a ping */
+typedef enum {
+    ULTRASONIC_NONE = 0,           // No ping finished yet
+    ULTRASONIC_ECHO,               // Echo completed
+    ULTRASONIC_NO_ECHO,            // Echo timed out
+} ultrasonic_status_t;
+
+/** @brief Published measurement of one sensor */
+typedef struct {
+    uint16_t echo_ticks;           // Echo length in TIM1 ticks, 0 without echo
+    uint32_t time_ms;              // tick_millis() when the ping finished
+    uint8_t status;                // ultrasonic_status_t
+    uint8_t sequence;              // Grows by 2 with every sample
+} ultrasonic_sample_t;
+
+/** @brief Sensor descriptor, pins are set by the application */
+typedef struct {
+    volatile uint8_t *trig_reg;    // Data Direction Register of trigger
+    uint8_t trig_pin;              // Trigger pin in the interval 0 to 7
+    volatile uint8_t *echo_reg;    // Data Direction Register of echo
+    uint8_t echo_pin;              // Echo pin in the interval 0 to 7
+    volatile uint8_t armed;        // Triggered, waiting for echo
+    volatile uint8_t echo_high;    // Rising edge of echo was seen
+    volatile uint16_t echo_start;  // TCNT1 at rising edge of echo
+    volatile uint8_t sequence;     // Odd while slot is being written
+    volatile uint16_t slot_ticks;  // Sample slot, see ultrasonic_sample_t
+    volatile uint32_t slot_ms;
+    volatile uint8_t slot_status;
+} ultrasonic_sensor_t;
+
+/** @brief Initializer of a descriptor table entry */
+#define ULTRASONIC_SENSOR(trig_reg, trig_pin, echo_reg, echo_pin) \
+    {(trig_reg), (trig_pin), (echo_reg), (echo_pin), 0, 0, 0, 0, 0, 0, 0}
 
 /* Function prototypes -----------------------------------------------*/
 /**
@@ -52,44 +101,103 @@ uint8_t  signal_pin;
  */
 
 /**
- * @brief  Configure pin and Timer/Counter1 for use with HC-SR04.
- * @param  trig_reg Address of Data Direction Register, such as &DDRB.
- * @param  trig_pin Trigger pin designation in the interval 0 to 7.
- * @param  echo_reg Address of Data Direction Register, such as &DDRB.
- * @param  echo_pin Incoming signal pin designation in the interval
- *                  0 to 7.
+ * @brief  Configure pins, pin change interrupts, Timer/Counter1 and 2.
+ * @param  sensors Sensor descriptor table, kept by the driver.
+ * @param  count   Number of sensors in the table, sensors past
+ *                 ULTRASONIC_MAX_SENSORS are ignored.
  * @return none
  */
-void ultrasonic_init(volatile uint8_t *trig_reg, uint8_t trig_pin, volatile uint8_t *echo_reg, uint8_t echo_pin);
+void ultrasonic_init(ultrasonic_sensor_t *sensors, uint8_t count);
 
 /**
- * @brief  Trigger ultrasonic sensor by sending 10us pulse.
- * @param  reg_name Address of Port Register, such as &PORTB.
- *         pin_num  Pin connected to trigger input of HC-SR04.
+ * @brief  Trigger one sensor by starting 10us pulse, returns at once.
+ * @param  id Index of sensor in descriptor table.
  * @return none
  */
-void ultrasonic_trigger(volatile uint8_t *reg_name, uint8_t pin_num);
+void ultrasonic_trigger(uint8_t id);
 
 /**
- * @brief  Start Timer/Counter1.
+ * @brief  End trigger pulse, call from Timer/Counter2 compare match A
+ *         interrupt.
  * @param  none
  * @return none
  */
-void ultrasonic_start_measuring();
+void ultrasonic_pulse_end();
 
 /**
- * @brief  Stop Timer/Counter1.
+ * @brief  Trigger sensors round-robin, one per call.
  * @param  none
- * @return none
+ * @return Index of triggered sensor
  */
-void ultrasonic_stop_measuring();
+uint8_t ultrasonic_trigger_next();
 
 /**
- * @brief  Stop measurement and get measured distance.
+ * @brief  Timestamp echo edges on one port, call from its pin change
+ *         interrupt.
+ * @param  pin_reg Address of Pin Register, such as &PIND.
+ * @param  now     TCNT1 read at the start of the interrupt.
+ * @return Bit mask of sensors whose echo has just completed
+ */
+uint8_t ultrasonic_echo_changed(volatile uint8_t *pin_reg, uint16_t now);
+
+/**
+ * @brief  End waiting for echoes, call ULTRASONIC_TIMEOUT_MS after
+ *         trigger.
  * @param  none
+ * @return Bit mask of sensors whose echo did not complete
+ */
+uint8_t ultrasonic_timeout();
+
+/**
+ * @brief  Correct distance conversion for air temperature.
+ * @param  celsius Air temperature in degrees Celsius
+ * @return none
+ */
+void ultrasonic_set_temperature(int8_t celsius);
+
+/**
+ * @brief  Copy the newest sample of a sensor, never torn, interrupts
+ *         stay enabled.
+ * @param  id     Index of sensor in descriptor table.
+ * @param  sample Destination of the copy.
+ * @return none
+ */
+void ultrasonic_get_sample(uint8_t id, ultrasonic_sample_t *sample);
+
+/**
+ * @brief  Convert echo length to distance.
+ * @param  echo_ticks Echo length in TIM1 ticks
  * @return Distance in cm
  */
-uint16_t ultrasonic_get_distance();
+uint16_t ultrasonic_ticks_to_cm(uint16_t echo_ticks);
+
+/**
+ * @brief  Convert echo length to distance in millimetres.
+ * @param  echo_ticks Echo length in TIM1 ticks
+ * @return Distance in mm, resolution is 0.085 mm per TIM1 tick
+ */
+uint16_t ultrasonic_ticks_to_mm(uint16_t echo_ticks);
+
+/**
+ * @brief  Length of the echo of the newest sample, raw for telemetry.
+ * @param  id Index of sensor in descriptor table.
+ * @return Echo length in TIM1 ticks, 0 after timeout
+ */
+uint16_t ultrasonic_get_echo_ticks(uint8_t id);
+
+/**
+ * @brief  Get distance of the last completed measurement.
+ * @param  id Index of sensor in descriptor table.
+ * @return Distance in cm
+ */
+uint16_t ultrasonic_get_distance(uint8_t id);
+
+/**
+ * @brief  Get distance of the last completed measurement in millimetres.
+ * @param  id Index of sensor in descriptor table.
+ * @return Distance in mm, resolution is 0.085 mm per TIM1 tick
+ */
+uint16_t ultrasonic_get_distance_mm(uint8_t id);
 
 /** @} */
 